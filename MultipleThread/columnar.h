@@ -0,0 +1,318 @@
+#ifndef MULTIPLETHREAD_COLUMNAR_H
+#define MULTIPLETHREAD_COLUMNAR_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "input.h"
+#include "statistics.h"
+#include "thread_pool.h"
+
+/**
+ * Packed binary columnar format
+ *
+ * Parsing text costs more than the statistics themselves, so a dataset can be converted once into a file
+ * whose columns are already arrays of integers. Loading it is a memory mapping: the columns are used in place,
+ * and their chunks are handed straight to the worker threads without being parsed or copied.
+ *
+ * Layout, every field little-endian:
+ * ```
+ * offset  size
+ *      0     8  magic "MTCOLUMN"
+ *      8     4  version (1)
+ *     12     4  number of columns
+ *     16     8  number of rows, the same for every column
+ *     24     8  reserved (0)
+ *     32  32*n  one descriptor per column:
+ *                 4  type (1 = int32, 2 = int64)
+ *                 4  reserved (0)
+ *                 8  offset of the column from the start of the file, a multiple of 64
+ *                16  name, padded with '\0'
+ * ```
+ * Each column is `rows` packed values starting at its offset. The offsets are aligned to a cache line,
+ * and a mapping starts on a page, so the values can be read as int / long long without any copy.
+ */
+
+const char columnarMagic[8] = {'M', 'T', 'C', 'O', 'L', 'U', 'M', 'N'};
+const std::uint32_t columnarVersion = 1;
+const std::size_t columnarHeaderSize = 32;
+const std::size_t columnarDescriptorSize = 32;
+const std::size_t columnarAlignment = 64;
+
+static_assert(sizeof(int) == 4 && sizeof(long long) == 8, "The columns are stored as 32-bit and 64-bit integers");
+
+enum class ColumnType : std::uint32_t {
+    Int32 = 1,
+    Int64 = 2
+};
+
+/**
+ * A column of a columnar file, or of the data to write into one
+ */
+struct Column {
+    std::string name;
+    ColumnType type = ColumnType::Int32;
+    const void *data = nullptr;  // rows values of type int or long long
+    std::size_t rows = 0;
+
+    std::size_t width() const { return type == ColumnType::Int32 ? 4 : 8; }
+};
+
+/**
+ * Check the byte order of the machine
+ * @return - True if the values of a column can be used without swapping their bytes
+ */
+inline bool hostIsLittleEndian() {
+    const std::uint16_t one = 1;
+    unsigned char first;
+    std::memcpy(&first, &one, 1);
+    return first == 1;
+}
+
+/**
+ * Read a little-endian unsigned integer of the header
+ * @param bytes - The first byte
+ * @return - The value
+ */
+template<typename T>
+T readLittle(const char *bytes) {
+    T value = 0;
+    for (std::size_t i = 0; i < sizeof(T); i++) {
+        value |= T(static_cast<unsigned char>(bytes[i])) << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * Append a little-endian unsigned integer to the header
+ * @param out - The header
+ * @param value - The value
+ */
+template<typename T>
+void writeLittle(std::vector<char> &out, T value) {
+    for (std::size_t i = 0; i < sizeof(T); i++) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+/**
+ * Check whether a buffer starts like a columnar file
+ * @param data - The buffer
+ * @param size - The size of the buffer
+ * @return - True if the magic matches
+ */
+inline bool isColumnar(const char *data, std::size_t size) {
+    return size >= sizeof(columnarMagic) && std::memcmp(data, columnarMagic, sizeof(columnarMagic)) == 0;
+}
+
+/**
+ * Check whether a file is a columnar file
+ * @param path - The path of the file
+ * @return - True if the file starts with the magic
+ */
+inline bool isColumnarFile(const std::string &path) {
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    char magic[sizeof(columnarMagic)];
+    std::size_t read = std::fread(magic, 1, sizeof(magic), file);
+    std::fclose(file);
+    return isColumnar(magic, read);
+}
+
+/**
+ * A memory-mapped columnar file
+ * The columns point into the mapping, they are valid as long as the ColumnarFile exists.
+ */
+class ColumnarFile {
+    MappedFile file;
+    std::vector<Column> columnList;
+    std::size_t rowCount = 0;
+
+public:
+    /**
+     * Map a columnar file and check its header
+     * @param path - The path of the file
+     */
+    explicit ColumnarFile(const std::string &path) : file(path) {
+        const char *data = file.data();
+        std::size_t size = file.size();
+        if (size < columnarHeaderSize || !isColumnar(data, size)) {
+            throw std::runtime_error(path + " is not a columnar file.");
+        }
+        if (readLittle<std::uint32_t>(data + 8) != columnarVersion) {
+            throw std::runtime_error(path + " has an unsupported columnar version.");
+        }
+        if (!hostIsLittleEndian()) {
+            throw std::runtime_error("Columnar files can only be loaded in place on a little-endian machine.");
+        }
+        std::uint32_t columns = readLittle<std::uint32_t>(data + 12);
+        std::uint64_t rows = readLittle<std::uint64_t>(data + 16);
+        if ((size - columnarHeaderSize) / columnarDescriptorSize < columns) {
+            throw std::runtime_error(path + " is truncated.");
+        }
+        rowCount = static_cast<std::size_t>(rows);
+
+        for (std::uint32_t c = 0; c < columns; c++) {
+            const char *descriptor = data + columnarHeaderSize + c * columnarDescriptorSize;
+            Column column;
+            std::uint32_t type = readLittle<std::uint32_t>(descriptor);
+            if (type != std::uint32_t(ColumnType::Int32) && type != std::uint32_t(ColumnType::Int64)) {
+                throw std::runtime_error(path + " has a column of an unknown type.");
+            }
+            column.type = static_cast<ColumnType>(type);
+            column.rows = rowCount;
+            column.name.assign(descriptor + 16, strnlen(descriptor + 16, 16));
+
+            std::uint64_t offset = readLittle<std::uint64_t>(descriptor + 8);
+            if (offset % columnarAlignment != 0 || offset > size || (size - offset) / column.width() < rows) {
+                throw std::runtime_error(path + " has a misplaced or truncated column.");
+            }
+            column.data = data + offset;
+            columnList.push_back(column);
+        }
+    }
+
+    std::size_t rows() const { return rowCount; }
+
+    const std::vector<Column> &columns() const { return columnList; }
+
+    /**
+     * Find a column by name, or by index if the name is a number
+     * @param name - The name or index, the first column if empty
+     * @return - The column
+     */
+    const Column &column(const std::string &name) const {
+        if (columnList.empty()) {
+            throw std::runtime_error("The columnar file has no columns.");
+        }
+        if (name.empty()) {
+            return columnList[0];
+        }
+        for (const auto &column: columnList) {
+            if (column.name == name) {
+                return column;
+            }
+        }
+        if (name.find_first_not_of("0123456789") == std::string::npos && std::stoul(name) < columnList.size()) {
+            return columnList[std::stoul(name)];
+        }
+        throw std::runtime_error("No column named " + name);
+    }
+};
+
+/**
+ * Write a columnar file
+ * @param path - The path of the file
+ * @param columns - The columns, all with the same number of rows and a name of at most 16 bytes
+ */
+inline void writeColumnar(const std::string &path, const std::vector<Column> &columns) {
+    if (!hostIsLittleEndian()) {
+        throw std::runtime_error("Columnar files can only be written on a little-endian machine.");
+    }
+    std::size_t rows = columns.empty() ? 0 : columns[0].rows;
+
+    // Place the columns one after the other, each on a cache line boundary
+    std::vector<std::uint64_t> offsets;
+    std::uint64_t offset = columnarHeaderSize + columnarDescriptorSize * columns.size();
+    for (const auto &column: columns) {
+        if (column.rows != rows || column.name.size() > 16) {
+            throw std::invalid_argument("The columns must have the same length and names of at most 16 bytes.");
+        }
+        offset = (offset + columnarAlignment - 1) / columnarAlignment * columnarAlignment;
+        offsets.push_back(offset);
+        offset += std::uint64_t(rows) * column.width();
+    }
+
+    std::vector<char> header(columnarMagic, columnarMagic + sizeof(columnarMagic));
+    writeLittle<std::uint32_t>(header, columnarVersion);
+    writeLittle<std::uint32_t>(header, static_cast<std::uint32_t>(columns.size()));
+    writeLittle<std::uint64_t>(header, rows);
+    writeLittle<std::uint64_t>(header, 0);
+    for (std::size_t c = 0; c < columns.size(); c++) {
+        writeLittle<std::uint32_t>(header, static_cast<std::uint32_t>(columns[c].type));
+        writeLittle<std::uint32_t>(header, 0);
+        writeLittle<std::uint64_t>(header, offsets[c]);
+        std::size_t nameStart = header.size();
+        header.resize(nameStart + 16, '\0');
+        std::memcpy(header.data() + nameStart, columns[c].name.data(), columns[c].name.size());
+    }
+
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+    bool ok = std::fwrite(header.data(), 1, header.size(), file) == header.size();
+    std::size_t written = header.size();
+    const char padding[columnarAlignment] = {};
+    for (std::size_t c = 0; c < columns.size() && ok; c++) {
+        ok = std::fwrite(padding, 1, offsets[c] - written, file) == offsets[c] - written;
+        std::size_t bytes = rows * columns[c].width();
+        ok = ok && std::fwrite(columns[c].data, 1, bytes, file) == bytes;
+        written = offsets[c] + bytes;
+    }
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
+
+/**
+ * Calculate the statistics of a column of a mapped file
+ * The chunks of the column are reduced in place by the thread pool.
+ *
+ * @param pool - The thread pool
+ * @param column - The column
+ * @return - The statistics, over 64-bit values for both column types
+ */
+inline Statistics64 columnStatistics(ThreadPool &pool, const Column &column) {
+    if (column.type == ColumnType::Int64) {
+        return parallelStatistics(pool, static_cast<const long long *>(column.data), column.rows);
+    }
+    Statistics stats = parallelStatistics(pool, static_cast<const int *>(column.data), column.rows);
+    Statistics64 wide;
+    wide.count = stats.count;
+    wide.sum = stats.sum;
+    wide.min = stats.count > 0 ? stats.min : wide.min;
+    wide.max = stats.count > 0 ? stats.max : wide.max;
+    wide.mean = stats.mean;
+    wide.m2 = stats.m2;
+    return wide;
+}
+
+/**
+ * Convert a text buffer into a columnar file with a single column named "value"
+ * @param pool - The thread pool parsing the text
+ * @param data - The text
+ * @param size - The size of the text
+ * @param path - The path of the columnar file
+ * @param type - The type of the column
+ * @return - The number of values written
+ */
+inline std::size_t convertText(ThreadPool &pool, const char *data, std::size_t size, const std::string &path,
+                               ColumnType type) {
+    Column column;
+    column.name = "value";
+    column.type = type;
+
+    std::vector<int> values32;
+    std::vector<long long> values64;
+    if (type == ColumnType::Int32) {
+        values32 = parallelParse<int>(pool, data, size);
+        column.data = values32.data();
+        column.rows = values32.size();
+    } else {
+        values64 = parallelParse<long long>(pool, data, size);
+        column.data = values64.data();
+        column.rows = values64.size();
+    }
+    writeColumnar(path, {column});
+    return column.rows;
+}
+
+#endif // MULTIPLETHREAD_COLUMNAR_H
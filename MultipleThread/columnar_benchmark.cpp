@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "columnar.h"
+#include "input.h"
+#include "parser.h"
+#include "statistics.h"
+#include "thread_pool.h"
+
+/**
+ * Columnar format benchmark
+ *
+ * Writes the same random values as a text file and as a columnar file, then measures the time
+ * from start-up (nothing loaded, no thread pool) to the first result, the merged statistics:
+ * - stoi: read the text, cut it into words and convert each with std::stoi into `int *numbers`,
+ *   the way the command-line arguments are handled, then reduce the array with the pool
+ * - from_chars: map the text, parse it with one from_chars thread per worker, then reduce the chunks
+ * - columnar: map the columnar file and reduce its column in place
+ *
+ * The files are read from the page cache, a cold start would add the same disk time to the text inputs
+ * and less to the smaller columnar file.
+ *
+ * Usage:
+ * ```bash
+ * ./MultipleThreadColumnarBenchmark [values] [threads]
+ * ```
+ */
+
+/**
+ * Measure the median time of a start-up
+ * @param repetitions - How often to repeat it
+ * @param run - The start-up, returns the sum it found
+ * @param expected - The correct sum
+ * @return - The median milliseconds, or -1 if the result was wrong
+ */
+template<typename Run>
+double measure(int repetitions, Run run, long long expected) {
+    std::vector<double> times;
+    for (int i = 0; i < repetitions; i++) {
+        auto start = std::chrono::steady_clock::now();
+        if (run() != expected) {
+            return -1;
+        }
+        auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    std::nth_element(times.begin(), times.begin() + repetitions / 2, times.end());
+    return times[repetitions / 2];
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t count = argc > 1 ? std::stoul(argv[1]) : 10000000;
+    unsigned threads = argc > 2 ? static_cast<unsigned>(std::stoul(argv[2])) : std::thread::hardware_concurrency();
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> distribution(-1000000000, 1000000000);
+    std::vector<int> values(count);
+    long long expected = 0;
+    for (auto &value: values) {
+        value = distribution(gen);
+        expected += value;
+    }
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path();
+    std::string textPath = (directory / "multiple_thread_benchmark.txt").string();
+    std::string columnarPath = (directory / "multiple_thread_benchmark.mtc").string();
+    {
+        std::ofstream text(textPath);
+        for (int value: values) {
+            text << value << '\n';
+        }
+        Column column;
+        column.name = "value";
+        column.data = values.data();
+        column.rows = values.size();
+        writeColumnar(columnarPath, {column});
+    }
+
+    int repetitions = 5;
+    double stoiTime = measure(repetitions, [&] {
+        ThreadPool pool(threads);
+        std::ifstream in(textPath);
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        std::vector<std::string> words;
+        std::string word;
+        while (buffer >> word) {
+            words.push_back(word);
+        }
+        int *numbers = new int[words.size()];
+        for (std::size_t i = 0; i < words.size(); i++) {
+            numbers[i] = std::stoi(words[i]);
+        }
+        long long sum = parallelStatistics(pool, numbers, words.size()).sum;
+        delete[] numbers;
+        return sum;
+    }, expected);
+
+    double fromCharsTime = measure(repetitions, [&] {
+        ThreadPool pool(threads);
+        MappedFile text(textPath);
+        std::vector<int> values = parallelParse(pool, text.data(), text.size());
+        return parallelStatistics(pool, values.data(), values.size()).sum;
+    }, expected);
+
+    double columnarTime = measure(repetitions, [&] {
+        ThreadPool pool(threads);
+        ColumnarFile columnar(columnarPath);
+        return static_cast<long long>(columnStatistics(pool, columnar.column("")).sum);
+    }, expected);
+
+    std::cout << "Milliseconds from start-up to the first result, " << count << " values, " << threads
+              << " thread(s)" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::setw(12) << "stoi" << std::setw(12) << stoiTime << std::endl;
+    std::cout << std::setw(12) << "from_chars" << std::setw(12) << fromCharsTime << std::endl;
+    std::cout << std::setw(12) << "columnar" << std::setw(12) << columnarTime << std::endl;
+
+    std::remove(textPath.c_str());
+    std::remove(columnarPath.c_str());
+    return 0;
+}
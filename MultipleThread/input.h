@@ -0,0 +1,512 @@
+#ifndef MULTIPLETHREAD_INPUT_H
+#define MULTIPLETHREAD_INPUT_H
+
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "parser.h"
+#include "statistics.h"
+#include "thread_pool.h"
+
+/**
+ * Large inputs do not fit on the command line, so they are read from a file or from stdin instead.
+ * The input is cut into fixed-size blocks which are handed to the worker threads as soon as they are available:
+ * - A file is memory-mapped, the blocks are views into the mapping and nothing is copied.
+ * - A stream (stdin) is read block by block into a bounded queue, so only a few blocks are in memory at once.
+ * While the pool reduces a block, the parent thread is already reading (or faulting in) the next one.
+ */
+
+/**
+ * The encoding of the input
+ * - Text: numbers separated by spaces, tabs, commas or newlines
+ * - Binary: little-endian 32-bit integers
+ */
+enum class InputFormat { Text, Binary };
+
+/**
+ * A block of input. It points into a memory-mapped file or into its own storage read from a stream.
+ */
+struct Block {
+    const char *data = nullptr;
+    std::size_t size = 0;
+    std::vector<char> storage;
+
+    Block() = default;
+    Block(Block &&) = default;
+    Block &operator=(Block &&) = default;
+    Block(const Block &) = delete;
+    Block &operator=(const Block &) = delete;
+};
+
+/**
+ * A bounded queue of blocks between the reading thread and the worker threads.
+ * The reader waits while the queue is full, which bounds the memory used by a stream to a few blocks.
+ */
+class BlockQueue {
+    std::deque<Block> blocks;
+    std::size_t capacity;
+    bool closed = false;
+    std::mutex mtx;
+    std::condition_variable not_full;
+    std::condition_variable not_empty;
+
+public:
+    explicit BlockQueue(std::size_t capacity) : capacity(capacity) {}
+
+    /**
+     * Add a block, waiting while the queue is full
+     * @param block - The block to add
+     */
+    void push(Block block) {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (blocks.size() >= capacity) {
+            not_full.wait(lock);
+        }
+        blocks.push_back(std::move(block));
+        not_empty.notify_one();
+    }
+
+    /**
+     * Take the next block, waiting while the queue is empty
+     * @param block - Receives the block
+     * @return - False once the queue is closed and drained
+     */
+    bool pop(Block &block) {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (blocks.empty() && !closed) {
+            not_empty.wait(lock);
+        }
+        if (blocks.empty()) {
+            return false;
+        }
+        block = std::move(blocks.front());
+        blocks.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    /**
+     * No more blocks will be added, wake up all the waiting workers
+     */
+    void close() {
+        std::lock_guard<std::mutex> lock(mtx);
+        closed = true;
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+};
+
+/**
+ * Decode a little-endian 32-bit integer
+ * @param p - The first of the four bytes
+ * @return - The decoded integer
+ */
+inline int decodeInt32(const char *p) {
+    auto *bytes = reinterpret_cast<const unsigned char *>(p);
+    unsigned int value = unsigned(bytes[0]) | unsigned(bytes[1]) << 8 | unsigned(bytes[2]) << 16 |
+                         unsigned(bytes[3]) << 24;
+    int result;
+    std::memcpy(&result, &value, sizeof(result));
+    return result;
+}
+
+/**
+ * Reduce a block into the statistics of the worker
+ * @param block - The block to reduce
+ * @param format - The encoding of the block
+ * @param stats - The statistics of the worker, or anything else with add(const int[], size_t), e.g. a SketchSummary
+ */
+template<typename Accumulator>
+void reduceBlock(const Block &block, InputFormat format, Accumulator &stats) {
+    // Parse or decode into a small buffer so that the values are added a tile at a time
+    int decoded[1024];
+    std::size_t used = 0;
+    auto append = [&](int value) {
+        decoded[used++] = value;
+        if (used == 1024) {
+            stats.add(decoded, used);
+            used = 0;
+        }
+    };
+    if (format == InputFormat::Text) {
+        parseText(block.data, block.data + block.size, append);
+    } else {
+        for (std::size_t i = 0; i + 4 <= block.size; i += 4) {
+            append(decodeInt32(block.data + i));
+        }
+    }
+    // Only the filled part of the buffer is passed on
+    if (used > 0) {
+        stats.add(decoded, used);
+    }
+}
+
+/**
+ * Find where the block starting at `begin` should end
+ * Text blocks are extended to the next separator so that no number is cut in half,
+ * binary blocks are kept a multiple of four bytes.
+ *
+ * @param data - The input
+ * @param size - The size of the input
+ * @param begin - The start of the block
+ * @param blockSize - The preferred size of a block
+ * @param format - The encoding of the input
+ * @return - The end of the block
+ */
+inline std::size_t blockEnd(const char *data, std::size_t size, std::size_t begin, std::size_t blockSize,
+                            InputFormat format) {
+    if (size - begin <= blockSize) {
+        return size;
+    }
+    std::size_t end = begin + blockSize;
+    if (format == InputFormat::Binary) {
+        return end - end % 4;
+    }
+    while (end < size && !isSeparator(data[end])) {
+        end++;
+    }
+    return end;
+}
+
+/**
+ * A read-only memory mapping of a whole file
+ */
+class MappedFile {
+    const char *address = nullptr;
+    std::size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+
+public:
+    explicit MappedFile(const std::string &path) {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("Failed to open " + path);
+        }
+        LARGE_INTEGER fileSize;
+        GetFileSizeEx(file, &fileSize);
+        length = static_cast<std::size_t>(fileSize.QuadPart);
+        if (length == 0) {
+            return;
+        }
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) {
+            CloseHandle(file);
+            throw std::runtime_error("Failed to map " + path);
+        }
+        address = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (address == nullptr) {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            throw std::runtime_error("Failed to map " + path);
+        }
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open " + path);
+        }
+        struct stat info{};
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            throw std::runtime_error("Failed to stat " + path);
+        }
+        length = static_cast<std::size_t>(info.st_size);
+        if (length == 0) {
+            close(fd);
+            return;
+        }
+        void *mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED) {
+            throw std::runtime_error("Failed to map " + path);
+        }
+        // The workers read the file front to back, let the kernel read ahead
+        madvise(mapped, length, MADV_SEQUENTIAL);
+        address = static_cast<const char *>(mapped);
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef _WIN32
+        if (address != nullptr) {
+            UnmapViewOfFile(address);
+        }
+        if (mapping != nullptr) {
+            CloseHandle(mapping);
+        }
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+        }
+#else
+        if (address != nullptr) {
+            munmap(const_cast<char *>(address), length);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data() const { return address; }
+
+    std::size_t size() const { return length; }
+};
+
+/**
+ * Reads a stream in blocks of a fixed size
+ * A text number cut at the end of a block is carried over to the next block,
+ * as are the trailing bytes of an incomplete binary integer.
+ *
+ * A partial reader returns whatever the stream has available instead of waiting for a full block,
+ * which is what a continuous stream needs: a value is passed on as soon as it has arrived.
+ */
+class StreamReader {
+    std::FILE *file;
+    std::size_t blockSize;
+    InputFormat format;
+    bool partial;
+    std::vector<char> carry;
+
+    /**
+     * Read up to `size` bytes
+     * @param buffer - The buffer to read into
+     * @param size - The most bytes to read
+     * @param eof - Set if the end of the stream has been reached
+     * @return - The number of bytes read
+     */
+    std::size_t read(char *buffer, std::size_t size, bool &eof) {
+        if (!partial) {
+            std::size_t count = std::fread(buffer, 1, size, file);
+            if (count < size) {
+                if (std::ferror(file)) {
+                    throw std::runtime_error("Failed to read the input.");
+                }
+                eof = true;
+            }
+            return count;
+        }
+#ifdef _WIN32
+        int count = _read(_fileno(file), buffer, static_cast<unsigned>(size));
+#else
+        ssize_t count;
+        do {
+            count = ::read(fileno(file), buffer, size);
+        } while (count < 0 && errno == EINTR);
+#endif
+        if (count < 0) {
+            throw std::runtime_error("Failed to read the input.");
+        }
+        eof = count == 0;
+        return static_cast<std::size_t>(count);
+    }
+
+public:
+    StreamReader(std::FILE *file, std::size_t blockSize, InputFormat format, bool partial = false)
+            : file(file), blockSize(blockSize), format(format), partial(partial) {}
+
+    /**
+     * Read the next block
+     * @param block - Receives the block
+     * @return - False at the end of the stream
+     */
+    bool next(Block &block) {
+        std::vector<char> buffer;
+        buffer.reserve(blockSize + carry.size());
+        buffer.swap(carry);
+
+        bool eof = false;
+        std::size_t cut = 0;
+        while (!eof) {
+            std::size_t used = buffer.size();
+            buffer.resize(used + blockSize);
+            buffer.resize(used + read(buffer.data() + used, blockSize, eof));
+
+            if (format == InputFormat::Binary) {
+                cut = buffer.size() - buffer.size() % 4;
+                if (cut > 0) {
+                    break;
+                }
+                continue;
+            }
+            // Cut after the last separator, a longer block is read if the block holds no separator at all
+            cut = buffer.size();
+            while (cut > 0 && !isSeparator(buffer[cut - 1])) {
+                cut--;
+            }
+            if (cut > 0) {
+                break;
+            }
+        }
+
+        if (eof) {
+            if (format == InputFormat::Binary && cut != buffer.size()) {
+                throw std::runtime_error("The binary input is truncated.");
+            }
+            cut = buffer.size();
+        }
+        carry.assign(buffer.begin() + static_cast<std::ptrdiff_t>(cut), buffer.end());
+        buffer.resize(cut);
+
+        if (buffer.empty() && eof) {
+            return false;
+        }
+        block.storage = std::move(buffer);
+        block.data = block.storage.data();
+        block.size = block.storage.size();
+        return true;
+    }
+};
+
+/**
+ * Reduce the blocks of the input with the tasks of a thread pool
+ * Every task drains the queue into its own statistics. The producer runs on the calling thread
+ * and pushes the blocks into the queue, so reading the next block overlaps with the tasks reducing the previous ones.
+ *
+ * @param pool - The thread pool
+ * @param produce - Called with the queue, pushes every block of the input
+ * @param format - The encoding of the input
+ * @param tasks - The number of tasks draining the queue
+ * @param identity - The empty accumulator every task starts from, it must have add(const int[], size_t) and merge
+ * @return - The merged statistics of all the tasks
+ */
+template<typename Producer, typename Accumulator = Statistics>
+Accumulator reduceBlocks(ThreadPool &pool, Producer produce, InputFormat format, unsigned tasks,
+                         const Accumulator &identity = Accumulator()) {
+    BlockQueue queue(2 * tasks);
+
+    std::vector<std::future<Accumulator>> partial;
+    partial.reserve(tasks);
+    for (unsigned t = 0; t < tasks; t++) {
+        partial.push_back(pool.submit([&queue, &identity, format] {
+            Accumulator stats = identity;
+            std::exception_ptr error;
+            Block block;
+            while (queue.pop(block)) {
+                // Keep draining after an error so that the producer never waits on a full queue
+                if (error) {
+                    continue;
+                }
+                try {
+                    reduceBlock(block, format, stats);
+                } catch (...) {
+                    error = std::current_exception();
+                }
+            }
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            return stats;
+        }));
+    }
+
+    std::exception_ptr producerError;
+    try {
+        produce(queue);
+    } catch (...) {
+        producerError = std::current_exception();
+    }
+    queue.close();
+
+    Accumulator result = identity;
+    std::exception_ptr taskError;
+    for (auto &future: partial) {
+        try {
+            result.merge(future.get());
+        } catch (...) {
+            taskError = taskError ? taskError : std::current_exception();
+        }
+    }
+    if (producerError) {
+        std::rethrow_exception(producerError);
+    }
+    if (taskError) {
+        std::rethrow_exception(taskError);
+    }
+    return result;
+}
+
+/**
+ * Calculate the statistics of a file by memory-mapping it
+ * @param pool - The thread pool reducing the blocks
+ * @param path - The path of the file
+ * @param format - The encoding of the file
+ * @param blockSize - The size of a block in bytes
+ * @param identity - The empty accumulator of every task
+ * @return - The statistics of the file
+ */
+template<typename Accumulator = Statistics>
+Accumulator mappedStatistics(ThreadPool &pool, const std::string &path, InputFormat format, std::size_t blockSize,
+                             const Accumulator &identity = Accumulator()) {
+    MappedFile file(path);
+    if (format == InputFormat::Binary && file.size() % 4 != 0) {
+        throw std::runtime_error("The binary input is truncated.");
+    }
+    return reduceBlocks(pool, [&](BlockQueue &queue) {
+        std::size_t begin = 0;
+        while (begin < file.size()) {
+            std::size_t end = blockEnd(file.data(), file.size(), begin, blockSize, format);
+            Block block;
+            block.data = file.data() + begin;
+            block.size = end - begin;
+            queue.push(std::move(block));
+            begin = end;
+        }
+    }, format, pool.size(), identity);
+}
+
+/**
+ * Calculate the statistics of a stream by reading it in blocks
+ * @param pool - The thread pool reducing the blocks
+ * @param file - The stream, e.g. stdin
+ * @param format - The encoding of the stream
+ * @param blockSize - The size of a block in bytes
+ * @param identity - The empty accumulator of every task
+ * @return - The statistics of the stream
+ */
+template<typename Accumulator = Statistics>
+Accumulator streamStatistics(ThreadPool &pool, std::FILE *file, InputFormat format, std::size_t blockSize,
+                             const Accumulator &identity = Accumulator()) {
+#ifdef _WIN32
+    // Do not let the C runtime translate line endings in binary input
+    if (format == InputFormat::Binary) {
+        _setmode(_fileno(file), _O_BINARY);
+    }
+#endif
+    StreamReader reader(file, blockSize, format);
+    return reduceBlocks(pool, [&](BlockQueue &queue) {
+        Block block;
+        while (reader.next(block)) {
+            queue.push(std::move(block));
+        }
+    }, format, pool.size(), identity);
+}
+
+#endif // MULTIPLETHREAD_INPUT_H
@@ -1,5 +1,27 @@
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <iomanip>
 #include <thread>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "columnar.h"
+#include "input.h"
+#include "parser.h"
+#include "percentile.h"
+#include "query.h"
+#include "scan.h"
+#include "sketch.h"
+#include "sliding_window.h"
+#include "thread_pool.h"
 
 /**
  * Write a multi-threaded program that calculates various statistical values for a list of numbers.
@@ -14,24 +36,86 @@
  * - The maximum value is 95.
  * The variables representing the average, minimum, and maximum values will be stored globally.
  * The worker threads will set these values, and the parent thread will output the values once the workers have exited.
+ *
+ * The average thread also reports the variance and the standard deviation.
+ * They are computed in the same pass with Welford's algorithm, and the sum is kept in 64 bits so it cannot overflow.
+ *
+ * Inputs too large for the command line can be read from a file or from stdin instead:
+ * ```bash
+ * ./MultipleThread 90 81 78 95 79 72 85
+ * ./MultipleThread --file numbers.txt [--binary] [--threads N] [--block-size BYTES]
+ * ./MultipleThread --stdin [--binary] [--threads N] [--block-size BYTES] < numbers.txt
+ * ```
+ * A file is memory-mapped and a stream is read in fixed-size blocks,
+ * the blocks are reduced by the worker threads as soon as they are available (see input.h).
+ *
+ * A continuous stream can be summarized over a sliding window instead, with a snapshot line written periodically:
+ * ```bash
+ * ./MultipleThread --stdin --window N [--window-seconds T] [--snapshot-every K] [--snapshot-ms M] [--snapshot-file path]
+ * ```
+ * The window holds the last N values and/or the values of the last T seconds (see sliding_window.h).
+ *
+ * Parsing the text can be skipped altogether by converting it once into the columnar format (see columnar.h):
+ * ```bash
+ * ./MultipleThread --file numbers.txt --convert numbers.mtc [--int64]
+ * ./MultipleThread --file numbers.mtc [--column NAME] [--threads N]
+ * ```
+ * A columnar file is recognized by its header, its column is mapped and reduced in place.
+ *
+ * The median and other percentiles are exact order statistics, selected in parallel without sorting (see percentile.h):
+ * ```bash
+ * ./MultipleThread --file numbers.txt --percentiles 50,90,99,99.9
+ * ```
+ * The whole input is loaded for them, except a columnar file which is used in place.
+ *
+ * The number of distinct values and the most frequent values are estimated with sketches (see sketch.h),
+ * built by every worker next to its statistics and merged at the end:
+ * ```bash
+ * ./MultipleThread --file numbers.txt --distinct [--hll-precision P] --top K [--sketch-error EPS] [--sketch-delta D]
+ * ```
+ *
+ * Element-wise outputs are written into a file of packed little-endian values through a memory mapping (see scan.h):
+ * 64-bit prefix sums, or the double averages of every window of K consecutive values.
+ * ```bash
+ * ./MultipleThread --file numbers.txt --prefix-sum --output sums.bin
+ * ./MultipleThread --file numbers.txt --moving-average K --output averages.bin
+ * ```
+ *
+ * Repeated questions about the same dataset can be answered by a server which loads it once (see query.h).
+ * The queries are read from stdin, or from the clients of a Unix domain socket:
+ * ```bash
+ * ./MultipleThread --file numbers.mtc --serve [--column NAME] [--socket path]
+ * ```
+ *
+ * The worker threads belong to a thread pool (see thread_pool.h) which is created once,
+ * the calculations are submitted to it as tasks instead of starting a new thread for each one.
  */
 
 // Global variables
-int average = 0;
+double average = 0;
+double variance = 0;
+double standardDeviation = 0;
 int min = 0;
 int max = 0;
 
 /**
- * Calculate the average value of the numbers
+ * Calculate the average value, the variance and the standard deviation of the numbers
  * @param numbers - The array of numbers
  * @param size - The size of the array
  */
 void calculateAverage(const int numbers[], const int size) {
-    double sum = 0;
+    long long sum = 0;
+    double mean = 0;
+    double m2 = 0;
     for (int i = 0; i < size; i++) {
         sum += numbers[i];
+        double delta = numbers[i] - mean;
+        mean += delta / (i + 1);
+        m2 += delta * (numbers[i] - mean);
     }
-    average = int(sum / size);
+    average = double(sum) / size;
+    variance = m2 / size;
+    standardDeviation = std::sqrt(variance);
 }
 
 /**
@@ -62,6 +146,473 @@ void calculateMax(const int numbers[], const int size) {
     }
 }
 
+/**
+ * Print the statistics of the streaming modes
+ * @param stats - The merged statistics
+ * @return - The exit code
+ */
+template<typename T>
+int printStatistics(const BasicStatistics<T> &stats) {
+    if (stats.count == 0) {
+        std::cout << "The input does not contain any numbers." << std::endl;
+        return 1;
+    }
+
+    average = stats.average();
+    variance = stats.variance();
+    standardDeviation = stats.standardDeviation();
+
+    std::cout << "The number of values is " << stats.count << std::endl;
+    std::cout << std::setprecision(15);
+    std::cout << "The average value is " << average << std::endl;
+    std::cout << "The variance is " << variance << std::endl;
+    std::cout << "The standard deviation is " << standardDeviation << std::endl;
+    std::cout << "The minimum value is " << stats.min << std::endl;
+    std::cout << "The maximum value is " << stats.max << std::endl;
+
+    return 0;
+}
+
+/**
+ * Print the estimates of the sketches
+ * @param summary - The merged summary
+ */
+void printSketches(const SketchSummary &summary) {
+    if (summary.options.distinct) {
+        std::cout << "The number of distinct values is about " << std::llround(summary.distinct.estimate())
+                  << " (standard error " << 100 * summary.distinct.standardError() << "%)" << std::endl;
+    }
+    if (summary.options.top > 0) {
+        std::cout << "The most frequent values are:" << std::endl;
+        std::vector<SpaceSaving::Counter> counters = summary.heavy.top(summary.options.top);
+        for (auto &counter: counters) {
+            // Both sketches overestimate, the smaller estimate is the better one
+            std::uint64_t count = std::min(counter.count, summary.frequency.estimate(hashValue(counter.value)));
+            // Keep the lower bound count - error
+            counter.error -= counter.count - count;
+            counter.count = count;
+        }
+        // The better estimates can change the order of the Space-Saving counters
+        std::stable_sort(counters.begin(), counters.end(),
+                         [](const SpaceSaving::Counter &a, const SpaceSaving::Counter &b) {
+                             return a.count > b.count;
+                         });
+        for (const auto &counter: counters) {
+            std::cout << "  " << counter.value << " seen about " << counter.count << " times (at least "
+                      << counter.count - counter.error << ")" << std::endl;
+        }
+    }
+}
+
+/**
+ * Print percentiles of the numbers
+ * @param pool - The thread pool
+ * @param numbers - The array of numbers
+ * @param size - The size of the array
+ * @param percentiles - The percentiles, from 0 to 100
+ */
+template<typename T>
+void printPercentiles(ThreadPool &pool, const T numbers[], std::size_t size, const std::vector<double> &percentiles) {
+    std::vector<double> values = parallelPercentiles(pool, numbers, size, percentiles);
+    for (std::size_t i = 0; i < percentiles.size(); i++) {
+        std::cout << "The " << percentiles[i] << "th percentile is " << values[i] << std::endl;
+    }
+}
+
+/**
+ * Parse a comma-separated list of percentiles
+ * @param text - The list, e.g. 50,90,99.9
+ * @return - The percentiles
+ */
+std::vector<double> parsePercentiles(const std::string &text) {
+    std::vector<double> percentiles;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        percentiles.push_back(std::stod(item));
+    }
+    return percentiles;
+}
+
+/**
+ * Decode a whole text or binary input into an array
+ * @param data - The input
+ * @param size - The size of the input
+ * @param format - The format of the input
+ * @param pool - The thread pool parsing the input
+ * @return - The numbers
+ */
+std::vector<int> loadValues(const char *data, std::size_t size, InputFormat format, ThreadPool &pool) {
+    if (format == InputFormat::Binary) {
+        if (size % 4 != 0) {
+            throw std::runtime_error("The binary input is not a whole number of 32-bit integers.");
+        }
+        std::vector<int> values(size / 4);
+        for (std::size_t i = 0; i < values.size(); i++) {
+            values[i] = decodeInt32(data + 4 * i);
+        }
+        return values;
+    }
+    return parallelParse(pool, data, size);
+}
+
+/**
+ * Read a whole stream into memory
+ * @param file - The stream
+ * @return - The bytes of the stream
+ */
+std::vector<char> readAll(std::FILE *file) {
+#ifdef _WIN32
+    // Keep the bytes of a binary input, '\r' is a separator in the text format anyway
+    _setmode(_fileno(file), _O_BINARY);
+#endif
+    std::vector<char> data;
+    char buffer[1 << 16];
+    std::size_t read;
+    while ((read = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data.insert(data.end(), buffer, buffer + read);
+    }
+    return data;
+}
+
+/**
+ * Calculate the statistics of a file or of stdin with the block reduction
+ * @param argc - The number of arguments
+ * @param argv - The arguments array, starting with an option
+ * @return - The exit code
+ */
+int runStreaming(int argc, char* argv[]) {
+    std::string path;
+    bool useStdin = false;
+    InputFormat format = InputFormat::Text;
+    unsigned threads = std::thread::hardware_concurrency();
+    std::size_t blockSize = 1 << 20;
+    bool useWindow = false;
+    WindowOptions window;
+    std::string snapshotPath;
+    std::string convertPath;
+    ColumnType columnType = ColumnType::Int32;
+    std::string columnName;
+    std::vector<double> percentiles;
+    SketchOptions sketches;
+    bool serve = false;
+    std::string socketPath;
+    bool prefixSum = false;
+    std::size_t movingAverage = 0;
+    std::string outputPath;
+
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (option == "--file" && hasValue) {
+            path = argv[++i];
+        } else if (option == "--stdin") {
+            useStdin = true;
+        } else if (option == "--binary") {
+            format = InputFormat::Binary;
+        } else if (option == "--threads" && hasValue) {
+            threads = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (option == "--block-size" && hasValue) {
+            blockSize = std::stoul(argv[++i]);
+        } else if (option == "--window" && hasValue) {
+            useWindow = true;
+            long long capacity = std::stoll(argv[++i]);
+            if (capacity <= 0) {
+                std::cout << "--window N must hold at least one value." << std::endl;
+                return 1;
+            }
+            window.capacity = static_cast<std::size_t>(capacity);
+        } else if (option == "--window-seconds" && hasValue) {
+            useWindow = true;
+            double seconds = std::stod(argv[++i]);
+            if (!(seconds > 0)) {
+                std::cout << "--window-seconds T must be positive." << std::endl;
+                return 1;
+            }
+            window.span = std::chrono::duration_cast<SlidingWindow::Clock::duration>(
+                    std::chrono::duration<double>(seconds));
+        } else if (option == "--snapshot-every" && hasValue) {
+            window.snapshotEvery = std::stoul(argv[++i]);
+        } else if (option == "--snapshot-ms" && hasValue) {
+            long milliseconds = std::stol(argv[++i]);
+            if (milliseconds <= 0) {
+                std::cout << "--snapshot-ms M must be positive." << std::endl;
+                return 1;
+            }
+            window.snapshotInterval = std::chrono::milliseconds(milliseconds);
+        } else if (option == "--snapshot-file" && hasValue) {
+            snapshotPath = argv[++i];
+        } else if (option == "--convert" && hasValue) {
+            convertPath = argv[++i];
+        } else if (option == "--int64") {
+            columnType = ColumnType::Int64;
+        } else if (option == "--column" && hasValue) {
+            columnName = argv[++i];
+        } else if (option == "--percentiles" && hasValue) {
+            percentiles = parsePercentiles(argv[++i]);
+        } else if (option == "--distinct") {
+            sketches.distinct = true;
+        } else if (option == "--top" && hasValue) {
+            sketches.top = std::stoul(argv[++i]);
+        } else if (option == "--hll-precision" && hasValue) {
+            sketches.precision = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (option == "--sketch-error" && hasValue) {
+            sketches.epsilon = std::stod(argv[++i]);
+        } else if (option == "--sketch-delta" && hasValue) {
+            sketches.delta = std::stod(argv[++i]);
+        } else if (option == "--prefix-sum") {
+            prefixSum = true;
+        } else if (option == "--moving-average" && hasValue) {
+            movingAverage = std::stoul(argv[++i]);
+        } else if (option == "--output" && hasValue) {
+            outputPath = argv[++i];
+        } else if (option == "--serve") {
+            serve = true;
+        } else if (option == "--socket" && hasValue) {
+            serve = true;
+            socketPath = argv[++i];
+        } else {
+            std::cout << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+    for (double p: percentiles) {
+        if (!(p >= 0 && p <= 100)) {
+            std::cout << "A percentile must be between 0 and 100." << std::endl;
+            return 1;
+        }
+    }
+    if (path.empty() == !useStdin) {
+        std::cout << "Please provide either --file <path> or --stdin." << std::endl;
+        return 1;
+    }
+    if ((prefixSum || movingAverage > 0) == outputPath.empty()) {
+        std::cout << "Please provide --output <path> with either --prefix-sum or --moving-average K." << std::endl;
+        return 1;
+    }
+    if (prefixSum && movingAverage > 0) {
+        std::cout << "Please choose one of --prefix-sum and --moving-average." << std::endl;
+        return 1;
+    }
+    if (movingAverage > maxMovingAveragePoints) {
+        std::cout << "--moving-average K takes at most " << maxMovingAveragePoints << " points." << std::endl;
+        return 1;
+    }
+    if (serve && useStdin && socketPath.empty()) {
+        std::cout << "The queries are read from stdin, please load the dataset with --file or use --socket." << std::endl;
+        return 1;
+    }
+    if (threads == 0) {
+        threads = 3;
+    }
+    if (blockSize < 4) {
+        blockSize = 4;
+    }
+
+    ThreadPool pool(threads);
+    if (!convertPath.empty()) {
+        try {
+            std::size_t rows;
+            if (useStdin) {
+                std::vector<char> text = readAll(stdin);
+                rows = convertText(pool, text.data(), text.size(), convertPath, columnType);
+            } else {
+                MappedFile text(path);
+                rows = convertText(pool, text.data(), text.size(), convertPath, columnType);
+            }
+            std::cout << "Converted " << rows << " values into " << convertPath << std::endl;
+        } catch (const std::exception &e) {
+            std::cout << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (serve) {
+        try {
+            auto start = std::chrono::steady_clock::now();
+            std::unique_ptr<Dataset> dataset;
+            if (!useStdin && isColumnarFile(path)) {
+                dataset.reset(new Dataset(std::unique_ptr<ColumnarFile>(new ColumnarFile(path)), columnName));
+            } else if (useStdin) {
+                std::vector<char> data = readAll(stdin);
+                dataset.reset(new Dataset(loadValues(data.data(), data.size(), format, pool)));
+            } else {
+                MappedFile file(path);
+                dataset.reset(new Dataset(loadValues(file.data(), file.size(), format, pool)));
+            }
+            auto end = std::chrono::steady_clock::now();
+            // The status goes to stderr, stdout only carries the answers
+            std::cerr << "Loaded " << dataset->column().rows << " values in " << std::fixed << std::setprecision(1)
+                      << std::chrono::duration<double, std::milli>(end - start).count() << " ms, " << threads
+                      << " thread(s)" << std::endl;
+            if (socketPath.empty()) {
+                serveQueries(pool, *dataset, stdin, stdout);
+            } else {
+                std::cerr << "Listening on " << socketPath << std::endl;
+                serveSocket(pool, *dataset, socketPath);
+            }
+        } catch (const std::exception &e) {
+            std::cout << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (!outputPath.empty()) {
+        try {
+            std::unique_ptr<ColumnarFile> columnar;
+            std::vector<int> values;
+            const int *numbers;
+            std::size_t size;
+            if (!useStdin && isColumnarFile(path)) {
+                columnar.reset(new ColumnarFile(path));
+                const Column &column = columnar->column(columnName);
+                if (column.type != ColumnType::Int32) {
+                    std::cout << "The prefix sums and moving averages need a 32-bit column." << std::endl;
+                    return 1;
+                }
+                numbers = static_cast<const int *>(column.data);
+                size = column.rows;
+            } else {
+                if (useStdin) {
+                    std::vector<char> data = readAll(stdin);
+                    values = loadValues(data.data(), data.size(), format, pool);
+                } else {
+                    MappedFile file(path);
+                    values = loadValues(file.data(), file.size(), format, pool);
+                }
+                numbers = values.data();
+                size = values.size();
+            }
+
+            // The output is not read back, it is written with streaming stores
+            if (prefixSum) {
+                MappedOutput output(outputPath, size * sizeof(long long));
+                parallelPrefixSum(pool, numbers, reinterpret_cast<long long *>(output.data()), size, true);
+                std::cout << "Wrote " << size << " prefix sums into " << outputPath << std::endl;
+            } else {
+                if (movingAverage > size) {
+                    std::cout << "The input has fewer than " << movingAverage << " values." << std::endl;
+                    return 1;
+                }
+                std::size_t windows = size - movingAverage + 1;
+                MappedOutput output(outputPath, windows * sizeof(double));
+                parallelMovingAverage(pool, numbers, reinterpret_cast<double *>(output.data()), size, movingAverage,
+                                      true);
+                std::cout << "Wrote " << windows << " moving averages into " << outputPath << std::endl;
+            }
+        } catch (const std::exception &e) {
+            std::cout << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (!useStdin && !useWindow && isColumnarFile(path)) {
+        try {
+            ColumnarFile columnar(path);
+            const Column &column = columnar.column(columnName);
+            int code = printStatistics(columnStatistics(pool, column));
+            if (code == 0 && !percentiles.empty() && column.type == ColumnType::Int64) {
+                printPercentiles(pool, static_cast<const long long *>(column.data), column.rows, percentiles);
+            } else if (code == 0 && !percentiles.empty()) {
+                printPercentiles(pool, static_cast<const int *>(column.data), column.rows, percentiles);
+            }
+            return code;
+        } catch (const std::exception &e) {
+            std::cout << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    if (!useWindow && !percentiles.empty()) {
+        try {
+            std::vector<int> values;
+            if (useStdin) {
+                std::vector<char> data = readAll(stdin);
+                values = loadValues(data.data(), data.size(), format, pool);
+            } else {
+                MappedFile file(path);
+                values = loadValues(file.data(), file.size(), format, pool);
+            }
+            Statistics stats = parallelStatistics(pool, values.data(), values.size());
+            min = stats.min;
+            max = stats.max;
+            int code = printStatistics(stats);
+            if (code == 0) {
+                printPercentiles(pool, values.data(), values.size(), percentiles);
+            }
+            return code;
+        } catch (const std::exception &e) {
+            std::cout << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    if (useWindow) {
+        std::FILE *file = useStdin ? stdin : std::fopen(path.c_str(), "rb");
+        if (file == nullptr) {
+            std::cout << "Failed to open " << path << std::endl;
+            return 1;
+        }
+        std::ofstream snapshotFile;
+        if (!snapshotPath.empty()) {
+            snapshotFile.open(snapshotPath);
+            if (!snapshotFile) {
+                std::cout << "Failed to open " << snapshotPath << std::endl;
+                return 1;
+            }
+        }
+        std::ostream &out = snapshotPath.empty() ? std::cout : snapshotFile;
+        out << std::setprecision(15);
+
+        window.format = format;
+        window.blockSize = std::min<std::size_t>(blockSize, 1 << 16);
+        try {
+            streamWindow(pool, file, window, out);
+        } catch (const std::exception &e) {
+            std::cout << e.what() << std::endl;
+            return 1;
+        }
+        if (file != stdin) {
+            std::fclose(file);
+        }
+        return 0;
+    }
+
+    if (sketches.distinct || sketches.top > 0) {
+        SketchSummary summary;
+        try {
+            SketchSummary identity(sketches);
+            summary = useStdin ? streamStatistics(pool, stdin, format, blockSize, identity)
+                               : mappedStatistics(pool, path, format, blockSize, identity);
+        } catch (const std::exception &e) {
+            std::cout << e.what() << std::endl;
+            return 1;
+        }
+        min = summary.stats.min;
+        max = summary.stats.max;
+        int code = printStatistics(summary.stats);
+        if (code == 0) {
+            printSketches(summary);
+        }
+        return code;
+    }
+
+    Statistics stats;
+    try {
+        stats = useStdin ? streamStatistics(pool, stdin, format, blockSize)
+                         : mappedStatistics(pool, path, format, blockSize);
+    } catch (const std::exception &e) {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+    min = stats.min;
+    max = stats.max;
+    return printStatistics(stats);
+}
+
 /**
  * Main function
  * @param argc - The number of arguments. Must be greater than 1
@@ -74,22 +625,36 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    if (std::string(argv[1]).compare(0, 2, "--") == 0) {
+        return runStreaming(argc, argv);
+    }
+
     int size = argc - 1;
     int* numbers = new int[size];
 
-    for(int i = 0; i < size; i++) {
-        numbers[i] = std::stoi(argv[i+1]);
+    try {
+        for (int i = 0; i < size; i++) {
+            numbers[i] = parseNumber(argv[i + 1]);
+        }
+    } catch (const std::exception &e) {
+        std::cout << e.what() << std::endl;
+        delete[] numbers;
+        return 1;
     }
 
-    std::thread t1(calculateAverage, numbers, size);
-    std::thread t2(calculateMin, numbers, size);
-    std::thread t3(calculateMax, numbers, size);
+    ThreadPool pool(3);
+    auto t1 = pool.submit(calculateAverage, numbers, size);
+    auto t2 = pool.submit(calculateMin, numbers, size);
+    auto t3 = pool.submit(calculateMax, numbers, size);
 
-    t1.join();
-    t2.join();
-    t3.join();
+    t1.get();
+    t2.get();
+    t3.get();
 
+    std::cout << std::setprecision(15);
     std::cout << "The average value is " << average << std::endl;
+    std::cout << "The variance is " << variance << std::endl;
+    std::cout << "The standard deviation is " << standardDeviation << std::endl;
     std::cout << "The minimum value is " << min << std::endl;
     std::cout << "The maximum value is " << max << std::endl;
 
@@ -0,0 +1,183 @@
+#ifndef MULTIPLETHREAD_PARSER_H
+#define MULTIPLETHREAD_PARSER_H
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "thread_pool.h"
+
+/**
+ * Text to integer parsing
+ *
+ * std::stoi builds a std::string for every number and checks the locale, std::strtol checks the locale too.
+ * std::from_chars does neither: it reads the digits straight from the buffer and reports where it stopped,
+ * which is all a list of plain decimal numbers needs.
+ *
+ * A large buffer is parsed in parallel on the thread pool by cutting it into chunks.
+ * The cuts are moved forward to the next separator so that no number is split between two chunks.
+ * The numbers of every chunk are counted first, so every chunk knows where its numbers start
+ * and parses them straight into their place in one output array.
+ */
+
+/**
+ * Check whether a character separates two numbers in the text format
+ * @param c - The character
+ * @return - True for spaces, tabs, commas and newlines
+ */
+inline bool isSeparator(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == ',';
+}
+
+/**
+ * Parse a single number, e.g. a command-line argument
+ * @param text - The null-terminated number
+ * @return - The parsed number
+ */
+inline int parseNumber(const char *text) {
+    const char *end = text;
+    while (*end != '\0') {
+        end++;
+    }
+    // from_chars does not accept a leading plus sign, and only a digit may follow it
+    const char *begin = text[0] == '+' && text[1] >= '0' && text[1] <= '9' ? text + 1 : text;
+    int value = 0;
+    auto result = std::from_chars(begin, end, value);
+    if (result.ec == std::errc::result_out_of_range) {
+        throw std::out_of_range("Number out of range: " + std::string(text));
+    }
+    if (result.ec != std::errc() || result.ptr != end || begin == end) {
+        throw std::invalid_argument("Invalid number: " + std::string(text));
+    }
+    return value;
+}
+
+/**
+ * Parse the numbers of a text buffer
+ * @tparam T - The integer type of the numbers, int unless a 64-bit column is being converted
+ * @param begin - The first character of the buffer
+ * @param end - One past the last character of the buffer
+ * @param sink - Called with every number in order
+ */
+template<typename T = int, typename Sink>
+void parseText(const char *begin, const char *end, Sink &&sink) {
+    const char *p = begin;
+    while (p < end) {
+        if (isSeparator(*p)) {
+            p++;
+            continue;
+        }
+        // from_chars does not accept a leading plus sign
+        if (*p == '+' && p + 1 < end && *(p + 1) >= '0' && *(p + 1) <= '9') {
+            p++;
+        }
+
+        T value = 0;
+        auto result = std::from_chars(p, end, value);
+        if (result.ec == std::errc::result_out_of_range) {
+            throw std::out_of_range("Number out of range in the input.");
+        }
+        if (result.ec != std::errc() || (result.ptr < end && !isSeparator(*result.ptr))) {
+            throw std::invalid_argument("Invalid number in the input.");
+        }
+        sink(value);
+        p = result.ptr;
+    }
+}
+
+/**
+ * Parse the numbers of a text buffer into an array
+ * The array must hold at least (end - begin + 1) / 2 numbers, the most a buffer of that size can contain.
+ *
+ * @param begin - The first character of the buffer
+ * @param end - One past the last character of the buffer
+ * @param out - The array to write the numbers to
+ * @return - The number of numbers written
+ */
+inline std::size_t parseInto(const char *begin, const char *end, int *out) {
+    std::size_t count = 0;
+    parseText(begin, end, [out, &count](int value) { out[count++] = value; });
+    return count;
+}
+
+/**
+ * Cut a text buffer into chunks without splitting a number
+ * @param data - The buffer
+ * @param size - The size of the buffer
+ * @param parts - The preferred number of chunks
+ * @return - The chunk boundaries, chunk i is [bounds[i], bounds[i + 1])
+ */
+inline std::vector<std::size_t> splitText(const char *data, std::size_t size, unsigned parts) {
+    std::vector<std::size_t> bounds{0};
+    for (unsigned i = 1; i < parts; i++) {
+        std::size_t cut = size / parts * i;
+        if (cut < bounds.back()) {
+            cut = bounds.back();
+        }
+        while (cut < size && !isSeparator(data[cut])) {
+            cut++;
+        }
+        bounds.push_back(cut);
+    }
+    bounds.push_back(size);
+    return bounds;
+}
+
+/**
+ * Count the numbers of a text buffer, the runs of characters between separators
+ * A buffer that parses without error has exactly one number per run.
+ * @param begin - The first character of the buffer
+ * @param end - One past the last character of the buffer
+ * @return - The number of runs
+ */
+inline std::size_t countNumbers(const char *begin, const char *end) {
+    std::size_t count = 0;
+    bool inNumber = false;
+    for (const char *p = begin; p < end; p++) {
+        bool separator = isSeparator(*p);
+        count += !separator && !inNumber;
+        inNumber = !separator;
+    }
+    return count;
+}
+
+/**
+ * Parse a text buffer on the thread pool
+ * @tparam T - The integer type of the numbers
+ * @param pool - The thread pool
+ * @param data - The buffer
+ * @param size - The size of the buffer
+ * @return - The numbers in input order
+ */
+template<typename T = int>
+std::vector<T> parallelParse(ThreadPool &pool, const char *data, std::size_t size) {
+    // A few chunks per worker, so a worker that finishes early can steal the rest
+    unsigned parts = std::max(1u, pool.size() * 4);
+    std::vector<std::size_t> bounds = splitText(data, size, parts);
+
+    // Where the numbers of each chunk start in the output
+    std::vector<std::size_t> offsets(parts + 1, 0);
+    pool.parallelFor(0, parts, 1, [&](std::size_t first, std::size_t last) {
+        for (std::size_t c = first; c < last; c++) {
+            offsets[c + 1] = countNumbers(data + bounds[c], data + bounds[c + 1]);
+        }
+    });
+    for (unsigned c = 0; c < parts; c++) {
+        offsets[c + 1] += offsets[c];
+    }
+
+    std::vector<T> values(offsets[parts]);
+    pool.parallelFor(0, parts, 1, [&](std::size_t first, std::size_t last) {
+        for (std::size_t c = first; c < last; c++) {
+            T *out = values.data() + offsets[c];
+            parseText<T>(data + bounds[c], data + bounds[c + 1], [&out](T value) { *out++ = value; });
+        }
+    });
+    return values;
+}
+
+#endif // MULTIPLETHREAD_PARSER_H
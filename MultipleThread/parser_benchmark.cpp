@@ -0,0 +1,127 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "parser.h"
+
+/**
+ * Parsing throughput benchmark
+ *
+ * Generates a buffer of random newline-separated numbers and reports how many megabytes per second
+ * each way of turning it into integers achieves:
+ * - std::stoi and std::strtol on null-terminated tokens, the way main() parses argv
+ * - std::from_chars on the buffer with one thread
+ * - std::from_chars on the buffer split into chunks on a thread pool, each parsed into its place in one array
+ *
+ * Usage:
+ * ```bash
+ * ./MultipleThreadParserBenchmark [megabytes] [threads]
+ * ```
+ */
+
+/**
+ * Measure the best of a few runs of a parser
+ * @param name - The name of the parser
+ * @param bytes - The size of the parsed text
+ * @param parse - The parser, returns the sum of the parsed numbers
+ * @param expected - The correct sum
+ */
+template<typename Parse>
+void measure(const std::string &name, std::size_t bytes, Parse parse, long long expected) {
+    double best = 0;
+    for (int run = 0; run < 3; run++) {
+        auto start = std::chrono::steady_clock::now();
+        long long sum = parse();
+        auto end = std::chrono::steady_clock::now();
+        if (sum != expected) {
+            std::cout << name << " parsed the wrong numbers." << std::endl;
+            std::exit(1);
+        }
+        double seconds = std::chrono::duration<double>(end - start).count();
+        double megabytesPerSecond = double(bytes) / (1 << 20) / seconds;
+        best = megabytesPerSecond > best ? megabytesPerSecond : best;
+    }
+    std::cout << std::left << std::setw(28) << name << std::right << std::setw(10) << std::fixed
+              << std::setprecision(1) << best << " MB/s" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t megabytes = argc > 1 ? std::stoul(argv[1]) : 64;
+    unsigned threads = argc > 2 ? static_cast<unsigned>(std::stoul(argv[2])) : std::thread::hardware_concurrency();
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    // Generate the text, with the tokens also stored null-terminated like argv
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> distribution(-1000000000, 1000000000);
+    std::string text;
+    text.reserve(megabytes << 20);
+    long long expected = 0;
+    while (text.size() < megabytes << 20) {
+        int value = distribution(gen);
+        expected += value;
+        text += std::to_string(value);
+        text += '\n';
+    }
+
+    std::string arguments = text;
+    std::vector<const char *> tokens;
+    std::size_t tokenStart = 0;
+    for (std::size_t i = 0; i < arguments.size(); i++) {
+        if (arguments[i] == '\n') {
+            arguments[i] = '\0';
+            tokens.push_back(arguments.data() + tokenStart);
+            tokenStart = i + 1;
+        }
+    }
+
+    std::cout << "Parsing " << tokens.size() << " numbers (" << megabytes << " MB) with " << threads
+              << " thread(s)" << std::endl;
+
+    // The pool is created before the measurements, like the pool of MultipleThread
+    ThreadPool pool(threads);
+    std::vector<int> numbers(tokens.size());
+    measure("std::stoi", text.size(), [&] {
+        long long sum = 0;
+        for (std::size_t i = 0; i < tokens.size(); i++) {
+            numbers[i] = std::stoi(tokens[i]);
+            sum += numbers[i];
+        }
+        return sum;
+    }, expected);
+
+    measure("std::strtol", text.size(), [&] {
+        long long sum = 0;
+        for (std::size_t i = 0; i < tokens.size(); i++) {
+            numbers[i] = static_cast<int>(std::strtol(tokens[i], nullptr, 10));
+            sum += numbers[i];
+        }
+        return sum;
+    }, expected);
+
+    measure("std::from_chars", text.size(), [&] {
+        std::size_t count = parseInto(text.data(), text.data() + text.size(), numbers.data());
+        long long sum = 0;
+        for (std::size_t i = 0; i < count; i++) {
+            sum += numbers[i];
+        }
+        return sum;
+    }, expected);
+
+    measure("std::from_chars parallel", text.size(), [&] {
+        std::vector<int> values = parallelParse(pool, text.data(), text.size());
+        long long sum = 0;
+        for (int value: values) {
+            sum += value;
+        }
+        return sum;
+    }, expected);
+
+    return 0;
+}
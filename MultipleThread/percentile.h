@@ -0,0 +1,391 @@
+#ifndef MULTIPLETHREAD_PERCENTILE_H
+#define MULTIPLETHREAD_PERCENTILE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "thread_pool.h"
+
+/**
+ * Exact order statistics without a full sort
+ *
+ * The median and the percentiles are values at given ranks of the sorted input. Sorting costs O(n log n)
+ * and is hard to spread over threads, but only the few values at the requested ranks are needed:
+ * 1. A sorted sample of the input gives splitters that cut the value range into buckets of about equal size.
+ * 2. The threads count how many values of their part fall into each bucket. The prefix sums of the counts
+ *    give the rank range of every bucket, so the bucket of each requested rank is known.
+ * 3. The threads copy only the values of those buckets, each part into its own precomputed slots.
+ * 4. Every needed bucket is searched with nth_element, one bucket per task.
+ * Two parallel passes over the input and a selection over a few small buckets replace the sort,
+ * and all the requested ranks are answered by the same passes.
+ *
+ * For a few ranks, a single pass is enough (Floyd and Rivest): the sample also predicts a narrow value interval
+ * around every requested rank, a few standard deviations of the sample rank wide. The threads count the values
+ * below each interval and copy the values inside it, with comparisons that do not branch. If every rank falls
+ * inside its interval, which fails with a probability well below one percent, only the small intervals are searched.
+ * Otherwise the bucket passes above are run.
+ */
+
+/**
+ * Select several ranks of a range with successive nth_element calls
+ * The middle rank is placed first, then the ranks on each side are selected in the part on their side.
+ *
+ * @param begin - The first value of the range
+ * @param end - One past the last value
+ * @param first - The first rank to select, relative to begin
+ * @param last - One past the last rank, the ranks are sorted
+ */
+template<typename Iterator, typename RankIterator>
+void selectRanks(Iterator begin, Iterator end, RankIterator first, RankIterator last) {
+    while (first != last) {
+        RankIterator middle = first + (last - first) / 2;
+        Iterator nth = begin + *middle;
+        std::nth_element(begin, nth, end);
+        // The left part keeps its ranks, the right part starts after nth
+        selectRanks(begin, nth, first, middle);
+        for (RankIterator r = middle + 1; r != last; ++r) {
+            *r -= *middle + 1;
+        }
+        begin = nth + 1;
+        first = middle + 1;
+    }
+}
+
+/**
+ * Draw a sorted sample of the numbers, spread over the whole array
+ * @param numbers - The array of numbers
+ * @param size - The size of the array
+ * @param samples - The size of the sample, at most size / 2
+ * @return - The sample, sorted
+ */
+template<typename T>
+std::vector<T> sortedSample(const T numbers[], std::size_t size, std::size_t samples) {
+    std::vector<T> sample(samples);
+    std::size_t stride = size / samples;
+    for (std::size_t i = 0; i < samples; i++) {
+        sample[i] = numbers[i * size / samples + (i * 7919) % stride];
+    }
+    std::sort(sample.begin(), sample.end());
+    return sample;
+}
+
+/**
+ * Find the values at a few ranks in a single pass over intervals predicted from a sample
+ * @param pool - The thread pool
+ * @param numbers - The array of numbers
+ * @param size - The size of the array
+ * @param wanted - The ranks, sorted and unique
+ * @param found - Set to the value at each rank on success
+ * @return - False if there are too many intervals or a rank fell outside its interval
+ */
+template<typename T>
+bool sampleSelect(ThreadPool &pool, const T numbers[], std::size_t size, const std::vector<std::size_t> &wanted,
+                  std::vector<T> &found) {
+    // About n^(2/3) samples, as Floyd and Rivest suggest
+    std::size_t samples = std::min<std::size_t>(size / 2, std::size_t(std::cbrt(double(size)) * std::cbrt(double(size))));
+    std::vector<T> sample = sortedSample(numbers, size, samples);
+
+    // The interval of each rank, three standard deviations of its sample rank on each side
+    std::vector<T> low;
+    std::vector<T> high;
+    std::vector<std::size_t> intervalOf;
+    for (std::size_t rank: wanted) {
+        double p = (double(rank) + 0.5) / double(size);
+        double center = p * double(samples);
+        double margin = 3 * std::sqrt(double(samples) * p * (1 - p)) + 2;
+        T from = sample[std::size_t(std::max(0.0, center - margin))];
+        T to = sample[std::min(samples - 1, std::size_t(center + margin))];
+        if (!low.empty() && from <= high.back()) {
+            high.back() = std::max(high.back(), to);
+        } else {
+            low.push_back(from);
+            high.push_back(to);
+        }
+        intervalOf.push_back(low.size() - 1);
+    }
+    const std::size_t intervals = low.size();
+    if (intervals > 8) {
+        return false;
+    }
+
+    // A value lies inside an interval if it is at least the low end of one more interval than it is above the high end
+    const std::size_t parts = std::min<std::size_t>(4 * pool.size(), size / 16384 + 1);
+    std::vector<std::vector<std::size_t>> belowCounts(parts, std::vector<std::size_t>(intervals));
+    std::vector<std::vector<std::vector<T>>> inside(parts, std::vector<std::vector<T>>(intervals));
+    pool.parallelFor(0, parts, 1, [&](std::size_t first, std::size_t last) {
+        for (std::size_t p = first; p < last; p++) {
+            std::size_t begin = size * p / parts;
+            std::size_t end = size * (p + 1) / parts;
+            // Local copies, so that the compiler keeps them in registers across the push_back calls
+            T lowEnd[8];
+            T highEnd[8];
+            std::size_t atLeast[8] = {};
+            const std::size_t count = intervals;
+            std::copy(low.begin(), low.end(), lowEnd);
+            std::copy(high.begin(), high.end(), highEnd);
+            std::vector<std::vector<T>> &gathered = inside[p];
+            for (std::size_t i = begin; i < end; i++) {
+                T value = numbers[i];
+                std::size_t region = 0;
+                for (std::size_t j = 0; j < count; j++) {
+                    std::size_t above = value >= lowEnd[j];
+                    atLeast[j] += above;
+                    region += above + std::size_t(value > highEnd[j]);
+                }
+                if (region % 2 == 1) {
+                    gathered[region / 2].push_back(value);
+                }
+            }
+            for (std::size_t j = 0; j < intervals; j++) {
+                belowCounts[p][j] = end - begin - atLeast[j];
+            }
+        }
+    });
+
+    std::vector<std::size_t> below(intervals);
+    std::vector<std::size_t> insideCount(intervals);
+    for (std::size_t p = 0; p < parts; p++) {
+        for (std::size_t j = 0; j < intervals; j++) {
+            below[j] += belowCounts[p][j];
+            insideCount[j] += inside[p][j].size();
+        }
+    }
+    for (std::size_t i = 0; i < wanted.size(); i++) {
+        std::size_t j = intervalOf[i];
+        if (wanted[i] < below[j] || wanted[i] >= below[j] + insideCount[j]) {
+            return false;
+        }
+    }
+
+    pool.parallelFor(0, intervals, 1, [&](std::size_t first, std::size_t last) {
+        for (std::size_t j = first; j < last; j++) {
+            std::vector<T> values;
+            values.reserve(insideCount[j]);
+            for (std::size_t p = 0; p < parts; p++) {
+                values.insert(values.end(), inside[p][j].begin(), inside[p][j].end());
+            }
+            std::vector<std::size_t> relative;
+            for (std::size_t i = 0; i < wanted.size(); i++) {
+                if (intervalOf[i] == j) {
+                    relative.push_back(wanted[i] - below[j]);
+                }
+            }
+            std::vector<std::size_t> positions = relative;
+            selectRanks(values.begin(), values.end(), relative.begin(), relative.end());
+            for (std::size_t i = 0, k = 0; i < wanted.size(); i++) {
+                if (intervalOf[i] == j) {
+                    found[i] = values[positions[k++]];
+                }
+            }
+        }
+    });
+    return true;
+}
+
+/**
+ * Find the values at several ranks of the sorted numbers
+ * @param pool - The thread pool
+ * @param numbers - The array of numbers, left unchanged
+ * @param size - The size of the array
+ * @param ranks - The ranks, from 0 (the minimum) to size - 1 (the maximum)
+ * @return - The value at each rank, in the order of the ranks
+ */
+template<typename T>
+std::vector<T> parallelSelect(ThreadPool &pool, const T numbers[], std::size_t size,
+                              const std::vector<std::size_t> &ranks) {
+    std::vector<std::size_t> wanted = ranks;
+    std::sort(wanted.begin(), wanted.end());
+    wanted.erase(std::unique(wanted.begin(), wanted.end()), wanted.end());
+    if (!wanted.empty() && wanted.back() >= size) {
+        throw std::out_of_range("A rank is past the end of the input.");
+    }
+
+    std::vector<T> found(wanted.size());
+    auto answer = [&]() {
+        std::vector<T> result;
+        for (std::size_t rank: ranks) {
+            result.push_back(found[std::lower_bound(wanted.begin(), wanted.end(), rank) - wanted.begin()]);
+        }
+        return result;
+    };
+
+    // Small inputs: a copy and nth_element cost less than scheduling the passes
+    if (size < (std::size_t(1) << 16)) {
+        std::vector<T> copy(numbers, numbers + size);
+        std::vector<std::size_t> relative = wanted;
+        selectRanks(copy.begin(), copy.end(), relative.begin(), relative.end());
+        for (std::size_t i = 0; i < wanted.size(); i++) {
+            found[i] = copy[wanted[i]];
+        }
+        return answer();
+    }
+
+    if (sampleSelect(pool, numbers, size, wanted, found)) {
+        return answer();
+    }
+
+    // 1. Splitters from a sorted sample, 8 samples per bucket
+    const std::size_t buckets = 1024;
+    const std::size_t samples = buckets * 8;
+    std::vector<T> sample = sortedSample(numbers, size, samples);
+    std::vector<T> splitters(buckets - 1);
+    for (std::size_t b = 0; b + 1 < buckets; b++) {
+        splitters[b] = sample[(b + 1) * samples / buckets];
+    }
+    // Bucket b holds the values in [splitters[b - 1], splitters[b]).
+    // The search halves the range with a conditional move instead of a branch,
+    // a branch would be mispredicted at almost every step on random input.
+    auto bucketOf = [&splitters](T value) {
+        const T *base = splitters.data();
+        std::size_t n = splitters.size();
+        while (n > 1) {
+            std::size_t half = n / 2;
+            base = base[half] <= value ? base + half : base;
+            n -= half;
+        }
+        return std::size_t(base - splitters.data()) + (*base <= value);
+    };
+
+    // 2. Count the values of every bucket, per part
+    const std::size_t parts = std::min<std::size_t>(4 * pool.size(), size / 16384 + 1);
+    std::vector<std::vector<std::size_t>> counts(parts, std::vector<std::size_t>(buckets));
+    pool.parallelFor(0, parts, 1, [&](std::size_t first, std::size_t last) {
+        for (std::size_t p = first; p < last; p++) {
+            std::vector<std::size_t> &count = counts[p];
+            for (std::size_t i = size * p / parts, end = size * (p + 1) / parts; i < end; i++) {
+                count[bucketOf(numbers[i])]++;
+            }
+        }
+    });
+
+    std::vector<std::size_t> bucketStart(buckets + 1);
+    for (std::size_t b = 0; b < buckets; b++) {
+        bucketStart[b + 1] = bucketStart[b];
+        for (std::size_t p = 0; p < parts; p++) {
+            bucketStart[b + 1] += counts[p][b];
+        }
+    }
+
+    // The buckets holding a wanted rank, and where their values go in the gathered array
+    std::vector<std::size_t> needed;
+    for (std::size_t rank: wanted) {
+        std::size_t b = std::upper_bound(bucketStart.begin(), bucketStart.end(), rank) - bucketStart.begin() - 1;
+        if (needed.empty() || needed.back() != b) {
+            needed.push_back(b);
+        }
+    }
+    const std::size_t none = std::size_t(-1);
+    std::vector<std::size_t> slot(buckets, none);
+    std::vector<std::size_t> gatherStart(needed.size() + 1);
+    for (std::size_t n = 0; n < needed.size(); n++) {
+        slot[needed[n]] = n;
+        gatherStart[n + 1] = gatherStart[n] + bucketStart[needed[n] + 1] - bucketStart[needed[n]];
+    }
+    std::vector<std::vector<std::size_t>> cursor(parts, std::vector<std::size_t>(needed.size()));
+    for (std::size_t n = 0; n < needed.size(); n++) {
+        std::size_t offset = gatherStart[n];
+        for (std::size_t p = 0; p < parts; p++) {
+            cursor[p][n] = offset;
+            offset += counts[p][needed[n]];
+        }
+    }
+
+    // 3. Copy the values of the needed buckets, every part writes its own slots.
+    // With few needed buckets, comparing with their bounds is cheaper than searching the bucket of every value.
+    struct Range {
+        T low;        // Inclusive
+        T high;       // Exclusive, unless the bucket is the last one
+        bool last;
+    };
+    std::vector<Range> ranges;
+    for (std::size_t b: needed) {
+        ranges.push_back({b == 0 ? std::numeric_limits<T>::lowest() : splitters[b - 1],
+                          b + 1 == buckets ? std::numeric_limits<T>::max() : splitters[b], b + 1 == buckets});
+    }
+    std::vector<T> gathered(gatherStart.back());
+    pool.parallelFor(0, parts, 1, [&](std::size_t first, std::size_t last) {
+        for (std::size_t p = first; p < last; p++) {
+            std::vector<std::size_t> &position = cursor[p];
+            for (std::size_t i = size * p / parts, end = size * (p + 1) / parts; i < end; i++) {
+                T value = numbers[i];
+                if (ranges.size() <= 16) {
+                    for (std::size_t n = 0; n < ranges.size(); n++) {
+                        if (value >= ranges[n].low && (value < ranges[n].high || ranges[n].last)) {
+                            gathered[position[n]++] = value;
+                            break;
+                        }
+                    }
+                } else {
+                    std::size_t n = slot[bucketOf(value)];
+                    if (n != none) {
+                        gathered[position[n]++] = value;
+                    }
+                }
+            }
+        }
+    });
+
+    // 4. Select the wanted ranks inside each needed bucket
+    pool.parallelFor(0, needed.size(), 1, [&](std::size_t first, std::size_t last) {
+        for (std::size_t n = first; n < last; n++) {
+            std::size_t base = bucketStart[needed[n]];
+            auto from = std::lower_bound(wanted.begin(), wanted.end(), base);
+            auto to = std::lower_bound(wanted.begin(), wanted.end(), bucketStart[needed[n] + 1]);
+            std::vector<std::size_t> relative;
+            for (auto r = from; r != to; ++r) {
+                relative.push_back(*r - base);
+            }
+            auto begin = gathered.begin() + gatherStart[n];
+            selectRanks(begin, gathered.begin() + gatherStart[n + 1], relative.begin(), relative.end());
+            for (auto r = from; r != to; ++r) {
+                found[r - wanted.begin()] = begin[*r - base];
+            }
+        }
+    });
+    return answer();
+}
+
+/**
+ * Calculate percentiles of the numbers
+ * A percentile between two ranks is interpolated linearly, so the 50th percentile of an even count
+ * is the average of the two middle values.
+ *
+ * @param pool - The thread pool
+ * @param numbers - The array of numbers, left unchanged
+ * @param size - The size of the array, must be positive
+ * @param percentiles - The percentiles, from 0 to 100
+ * @return - The value of each percentile
+ */
+template<typename T>
+std::vector<double> parallelPercentiles(ThreadPool &pool, const T numbers[], std::size_t size,
+                                        const std::vector<double> &percentiles) {
+    if (size == 0) {
+        throw std::invalid_argument("The input does not contain any numbers.");
+    }
+    std::vector<std::size_t> ranks;
+    for (double p: percentiles) {
+        if (!(p >= 0 && p <= 100)) {
+            throw std::invalid_argument("A percentile must be between 0 and 100.");
+        }
+        double position = p / 100 * double(size - 1);
+        ranks.push_back(static_cast<std::size_t>(std::floor(position)));
+        ranks.push_back(static_cast<std::size_t>(std::ceil(position)));
+    }
+
+    std::vector<T> values = parallelSelect(pool, numbers, size, ranks);
+    std::vector<double> result;
+    for (std::size_t i = 0; i < percentiles.size(); i++) {
+        double position = percentiles[i] / 100 * double(size - 1);
+        double fraction = position - std::floor(position);
+        double low = double(values[2 * i]);
+        double high = double(values[2 * i + 1]);
+        result.push_back(low + fraction * (high - low));
+    }
+    return result;
+}
+
+#endif // MULTIPLETHREAD_PERCENTILE_H
@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "percentile.h"
+#include "thread_pool.h"
+
+/**
+ * Percentile benchmark
+ *
+ * Calculates the median, p90, p99 and p99.9 of arrays of growing size and reports the milliseconds per call:
+ * - sort: copy the array, std::sort it and index the ranks
+ * - nth_element: copy the array and select the ranks with successive std::nth_element calls, on one thread
+ * - parallel: parallelPercentiles on a thread pool created once
+ * The speedup is the time of the sort over the time of the parallel selection.
+ *
+ * Usage:
+ * ```bash
+ * ./MultipleThreadPercentileBenchmark [threads] [max size]
+ * ```
+ */
+
+/**
+ * Measure the median time of a computation
+ * @param repetitions - How often to repeat it
+ * @param compute - The computation, returns the percentiles it found
+ * @param expected - The correct percentiles, empty to skip the check
+ * @return - The median milliseconds, or -1 if the result was wrong
+ */
+template<typename Compute>
+double measure(int repetitions, Compute compute, const std::vector<double> &expected) {
+    std::vector<double> times;
+    for (int i = 0; i < repetitions; i++) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<double> result = compute();
+        auto end = std::chrono::steady_clock::now();
+        if (!expected.empty() && result != expected) {
+            return -1;
+        }
+        times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    std::nth_element(times.begin(), times.begin() + repetitions / 2, times.end());
+    return times[repetitions / 2];
+}
+
+/**
+ * Interpolate the percentiles from the values at their surrounding ranks, like parallelPercentiles
+ * @param at - Returns the value at a rank
+ * @param size - The number of values
+ * @param percentiles - The percentiles
+ * @return - The value of each percentile
+ */
+template<typename At>
+std::vector<double> interpolate(At at, std::size_t size, const std::vector<double> &percentiles) {
+    std::vector<double> result;
+    for (double p: percentiles) {
+        double position = p / 100 * double(size - 1);
+        double low = double(at(static_cast<std::size_t>(std::floor(position))));
+        double high = double(at(static_cast<std::size_t>(std::ceil(position))));
+        result.push_back(low + (position - std::floor(position)) * (high - low));
+    }
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned threads = argc > 1 ? static_cast<unsigned>(std::stoul(argv[1])) : std::thread::hardware_concurrency();
+    if (threads == 0) {
+        threads = 1;
+    }
+    std::size_t maxSize = argc > 2 ? std::stoul(argv[2]) : 10000000;
+    ThreadPool pool(threads);
+    const std::vector<double> percentiles = {50, 90, 99, 99.9};
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> distribution(-1000000000, 1000000000);
+
+    std::cout << "Milliseconds for p50, p90, p99 and p99.9 with " << threads << " thread(s)" << std::endl;
+    std::cout << std::setw(10) << "size" << std::setw(14) << "sort" << std::setw(14) << "nth_element"
+              << std::setw(14) << "parallel" << std::setw(14) << "speedup" << std::endl;
+
+    for (std::size_t size = 10000; size <= maxSize; size *= 10) {
+        std::vector<int> numbers(size);
+        for (auto &number: numbers) {
+            number = distribution(gen);
+        }
+        int repetitions = size >= 10000000 ? 3 : 7;
+
+        std::vector<double> expected;
+        double sortTime = measure(repetitions, [&] {
+            std::vector<int> copy = numbers;
+            std::sort(copy.begin(), copy.end());
+            expected = interpolate([&copy](std::size_t rank) { return copy[rank]; }, size, percentiles);
+            return expected;
+        }, {});
+
+        double selectTime = measure(repetitions, [&] {
+            std::vector<int> copy = numbers;
+            std::vector<std::size_t> ranks;
+            for (double p: percentiles) {
+                double position = p / 100 * double(size - 1);
+                ranks.push_back(static_cast<std::size_t>(std::floor(position)));
+                ranks.push_back(static_cast<std::size_t>(std::ceil(position)));
+            }
+            std::sort(ranks.begin(), ranks.end());
+            ranks.erase(std::unique(ranks.begin(), ranks.end()), ranks.end());
+            std::vector<std::size_t> relative = ranks;
+            selectRanks(copy.begin(), copy.end(), relative.begin(), relative.end());
+            return interpolate([&copy](std::size_t rank) { return copy[rank]; }, size, percentiles);
+        }, expected);
+
+        double parallelTime = measure(repetitions, [&] {
+            return parallelPercentiles(pool, numbers.data(), size, percentiles);
+        }, expected);
+
+        std::cout << std::setw(10) << size << std::fixed << std::setprecision(3) << std::setw(14) << sortTime
+                  << std::setw(14) << selectTime << std::setw(14) << parallelTime << std::setprecision(2)
+                  << std::setw(14) << sortTime / parallelTime << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,435 @@
+#ifndef MULTIPLETHREAD_QUERY_H
+#define MULTIPLETHREAD_QUERY_H
+
+#include <cerrno>
+#include <csignal>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "columnar.h"
+#include "statistics.h"
+#include "thread_pool.h"
+
+/**
+ * Resident dataset queries
+ *
+ * A normal run parses its input, starts its threads, computes once and exits,
+ * so every question about the same dataset pays for loading it again.
+ * In server mode the dataset is loaded once and the thread pool stays alive,
+ * and a stream of queries is answered from memory, one line per query:
+ * ```
+ * all                       every row
+ * rows BEGIN END            the rows BEGIN to END - 1
+ * values LOW HIGH           the values between LOW and HIGH inclusive, * for no bound
+ * rows 0 1000 values 10 *   both restrictions
+ * info                      the number of rows and the type of the values
+ * quit                      end the session
+ * shutdown                  end the session and stop the server
+ * ```
+ * Each answer is a single line with the count, sum, average, minimum and maximum of the selected values
+ * and the time taken to answer, in microseconds:
+ * ```
+ * count=1000 sum=500500 avg=500.5 min=1 max=1000 latency_us=41.2
+ * ```
+ * A malformed query is answered with a line starting with "error:".
+ */
+
+/**
+ * The values of the server, either loaded into memory or a column used in place
+ */
+class Dataset {
+    std::unique_ptr<ColumnarFile> columnar;
+    std::vector<int> owned;
+    Column values;
+
+public:
+    /**
+     * @param numbers - The loaded values
+     */
+    explicit Dataset(std::vector<int> numbers) : owned(std::move(numbers)) {
+        values.name = "value";
+        values.type = ColumnType::Int32;
+        values.data = owned.data();
+        values.rows = owned.size();
+    }
+
+    /**
+     * @param file - A mapped columnar file
+     * @param column - The name or index of the column, the first one if empty
+     */
+    Dataset(std::unique_ptr<ColumnarFile> file, const std::string &column)
+            : columnar(std::move(file)), values(columnar->column(column)) {}
+
+    Dataset(const Dataset &) = delete;
+    Dataset &operator=(const Dataset &) = delete;
+
+    const Column &column() const { return values; }
+};
+
+/**
+ * A query: the rows in [begin, end) whose value is in [low, high]
+ */
+struct Query {
+    std::size_t begin = 0;
+    std::size_t end = std::numeric_limits<std::size_t>::max();
+    long long low = std::numeric_limits<long long>::min();
+    long long high = std::numeric_limits<long long>::max();
+};
+
+/**
+ * The aggregates of the values selected by a query
+ */
+template<typename T>
+struct QueryResult {
+    using Sum = typename SumType<T>::type;
+
+    long long count = 0;
+    Sum sum = 0;
+    T min = std::numeric_limits<T>::max();
+    T max = std::numeric_limits<T>::lowest();
+
+    void merge(const QueryResult &other) {
+        count += other.count;
+        sum += other.sum;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+    }
+};
+
+/**
+ * Parse a number of a query
+ * @param text - The number
+ * @return - The number
+ */
+inline long long parseQueryNumber(const std::string &text) {
+    std::size_t used = 0;
+    long long number;
+    try {
+        number = std::stoll(text, &used);
+    } catch (const std::exception &) {
+        used = 0;
+    }
+    if (used == 0 || used != text.size()) {
+        throw std::invalid_argument(text + " is not a 64-bit integer");
+    }
+    return number;
+}
+
+/**
+ * Parse a query line
+ * @param line - The words of the query, e.g. "rows 0 100 values 5 *"
+ * @return - The query
+ */
+inline Query parseQuery(const std::string &line) {
+    Query query;
+    std::istringstream words(line);
+    std::string word;
+    while (words >> word) {
+        if (word == "all") {
+            continue;
+        }
+        if (word != "rows" && word != "values") {
+            throw std::invalid_argument("unknown query " + word);
+        }
+        std::string first, second;
+        if (!(words >> first >> second)) {
+            throw std::invalid_argument(word + " needs two arguments");
+        }
+        if (word == "rows") {
+            long long begin = parseQueryNumber(first);
+            long long end = parseQueryNumber(second);
+            if (begin < 0 || end < 0) {
+                throw std::invalid_argument("rows cannot be negative");
+            }
+            query.begin = static_cast<std::size_t>(begin);
+            query.end = static_cast<std::size_t>(end);
+        } else {
+            // * leaves a side of the interval open
+            query.low = first == "*" ? std::numeric_limits<long long>::min() : parseQueryNumber(first);
+            query.high = second == "*" ? std::numeric_limits<long long>::max() : parseQueryNumber(second);
+        }
+    }
+    return query;
+}
+
+/**
+ * Aggregate the values of a range that fall into an interval
+ * The comparisons select without branches, so the loop does not depend on how many values match.
+ *
+ * @param numbers - The values
+ * @param size - The number of values
+ * @param low - The lowest value to include
+ * @param high - The highest value to include
+ * @return - The aggregates
+ */
+template<typename T>
+QueryResult<T> aggregate(const T numbers[], std::size_t size, T low, T high) {
+    QueryResult<T> result;
+    long long count = 0;
+    typename QueryResult<T>::Sum sum = 0;
+    T min = result.min;
+    T max = result.max;
+    for (std::size_t i = 0; i < size; i++) {
+        T value = numbers[i];
+        bool selected = value >= low && value <= high;
+        count += selected;
+        sum += selected ? value : 0;
+        min = selected && value < min ? value : min;
+        max = selected && value > max ? value : max;
+    }
+    result.count = count;
+    result.sum = sum;
+    result.min = min;
+    result.max = max;
+    return result;
+}
+
+/**
+ * Answer a query over an array on the thread pool
+ * @param pool - The thread pool
+ * @param numbers - The values
+ * @param size - The number of values
+ * @param query - The query, its rows are clamped to the array
+ * @return - The aggregates
+ */
+template<typename T>
+QueryResult<T> runQuery(ThreadPool &pool, const T numbers[], std::size_t size, const Query &query) {
+    std::size_t begin = std::min(query.begin, size);
+    std::size_t end = std::max(begin, std::min(query.end, size));
+    // A bound outside of T selects everything on that side
+    const long long lowest = std::numeric_limits<T>::min();
+    const long long highest = std::numeric_limits<T>::max();
+    if (query.low > query.high || query.low > highest || query.high < lowest) {
+        return QueryResult<T>();
+    }
+    T low = static_cast<T>(std::max(query.low, lowest));
+    T high = static_cast<T>(std::min(query.high, highest));
+
+    // A short range is answered by the calling thread alone, it would wait longer for the workers than it runs
+    std::size_t grain = std::max<std::size_t>((end - begin) / (4 * pool.size()) + 1, 65536);
+    return pool.parallelReduce(begin, end, grain, QueryResult<T>(),
+                               [numbers, low, high](std::size_t chunkBegin, std::size_t chunkEnd) {
+                                   return aggregate(numbers + chunkBegin, chunkEnd - chunkBegin, low, high);
+                               },
+                               [](QueryResult<T> &result, const QueryResult<T> &chunk) { result.merge(chunk); });
+}
+
+/**
+ * Write an exact sum in decimal
+ * @param sum - The sum
+ * @return - Its digits
+ */
+inline std::string sumToString(long long sum) {
+    return std::to_string(sum);
+}
+
+#ifdef __SIZEOF_INT128__
+// The sum of 64-bit values may not fit into long long, and the standard library does not print __int128
+inline std::string sumToString(__int128 sum) {
+    bool negative = sum < 0;
+    std::string digits;
+    do {
+        int digit = int(sum % 10);
+        digits.insert(digits.begin(), char('0' + (negative ? -digit : digit)));
+        sum /= 10;
+    } while (sum != 0);
+    return negative ? "-" + digits : digits;
+}
+#else
+inline std::string sumToString(long double sum) {
+    std::ostringstream out;
+    out.precision(21);
+    out << sum;
+    return out.str();
+}
+#endif
+
+/**
+ * Write the answer of a query
+ * @param result - The aggregates
+ * @param microseconds - The time taken to answer
+ * @return - The answer line, without the newline
+ */
+template<typename T>
+std::string formatResult(const QueryResult<T> &result, double microseconds) {
+    std::ostringstream out;
+    out.precision(15);
+    out << "count=" << result.count;
+    if (result.count > 0) {
+        out << " sum=" << sumToString(result.sum) << " avg=" << double(result.sum) / double(result.count)
+            << " min=" << result.min << " max=" << result.max;
+    }
+    out.precision(3);
+    out << std::fixed << " latency_us=" << microseconds;
+    return out.str();
+}
+
+/**
+ * Answer a query line
+ * @param pool - The thread pool
+ * @param dataset - The dataset
+ * @param line - The query
+ * @return - The answer line, without the newline
+ */
+inline std::string answerQuery(ThreadPool &pool, const Dataset &dataset, const std::string &line) {
+    const Column &column = dataset.column();
+    if (line == "info") {
+        return "rows=" + std::to_string(column.rows) + " type=" +
+               (column.type == ColumnType::Int64 ? "int64" : "int32");
+    }
+    try {
+        auto start = std::chrono::steady_clock::now();
+        Query query = parseQuery(line);
+        if (column.type == ColumnType::Int64) {
+            auto result = runQuery(pool, static_cast<const long long *>(column.data), column.rows, query);
+            auto end = std::chrono::steady_clock::now();
+            return formatResult(result, std::chrono::duration<double, std::micro>(end - start).count());
+        }
+        auto result = runQuery(pool, static_cast<const int *>(column.data), column.rows, query);
+        auto end = std::chrono::steady_clock::now();
+        return formatResult(result, std::chrono::duration<double, std::micro>(end - start).count());
+    } catch (const std::exception &e) {
+        return std::string("error: ") + e.what();
+    }
+}
+
+/**
+ * Read a line of a stream
+ * @param file - The stream
+ * @param line - Receives the line without its newline (and carriage return)
+ * @return - False at the end of the stream
+ */
+inline bool readLine(std::FILE *file, std::string &line) {
+    line.clear();
+    char buffer[256];
+    while (std::fgets(buffer, sizeof(buffer), file) != nullptr) {
+        line += buffer;
+        if (line.back() == '\n') {
+            break;
+        }
+    }
+    if (line.empty()) {
+        return false;
+    }
+    while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) {
+        line.pop_back();
+    }
+    return true;
+}
+
+/**
+ * Answer the queries of a session until it ends
+ * @param pool - The thread pool
+ * @param dataset - The dataset
+ * @param in - The queries, one per line
+ * @param out - The answers, one per line, flushed after each
+ * @return - True if the session asked to stop the server, false when it ended or the answers could not be written
+ */
+inline bool serveQueries(ThreadPool &pool, const Dataset &dataset, std::FILE *in, std::FILE *out) {
+    std::string line;
+    while (readLine(in, line)) {
+        std::size_t first = line.find_first_not_of(" \t");
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+        line = line.substr(first, line.find_last_not_of(" \t") - first + 1);
+        if (line == "quit") {
+            return false;
+        }
+        if (line == "shutdown") {
+            return true;
+        }
+        std::string answer = answerQuery(pool, dataset, line);
+        std::fputs(answer.c_str(), out);
+        std::fputc('\n', out);
+        if (std::fflush(out) != 0 || std::ferror(out)) {
+            // The client has gone away
+            return false;
+        }
+    }
+    return false;
+}
+
+/**
+ * Answer the queries of clients connecting to a Unix domain socket, one client at a time,
+ * until a client sends "shutdown"
+ * A client has all the workers to itself, the queries are already parallel inside.
+ *
+ * @param pool - The thread pool
+ * @param dataset - The dataset
+ * @param path - The path of the socket, replaced if it exists
+ */
+inline void serveSocket(ThreadPool &pool, const Dataset &dataset, const std::string &path) {
+#ifdef _WIN32
+    (void) pool;
+    (void) dataset;
+    throw std::runtime_error("Unix domain sockets are not supported on this platform, " + path);
+#else
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("The socket path is too long: " + path);
+    }
+    std::strcpy(address.sun_path, path.c_str());
+
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0) {
+        throw std::runtime_error("Failed to create a socket");
+    }
+    unlink(path.c_str());
+    if (bind(server, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(server, 16) != 0) {
+        close(server);
+        throw std::runtime_error("Failed to listen on " + path);
+    }
+
+    // A client that disconnects before reading its answers must only end its own session,
+    // writing to it fails with EPIPE instead of killing the server with SIGPIPE
+    void (*previousHandler)(int) = signal(SIGPIPE, SIG_IGN);
+
+    bool stop = false;
+    while (!stop) {
+        int client = accept(server, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        // Separate streams for each direction, a single read/write stream would need a seek between them
+        std::FILE *in = fdopen(client, "r");
+        int writeFd = dup(client);
+        std::FILE *out = writeFd >= 0 ? fdopen(writeFd, "w") : nullptr;
+        if (in != nullptr && out != nullptr) {
+            stop = serveQueries(pool, dataset, in, out);
+        }
+        if (out != nullptr) {
+            std::fclose(out);
+        } else if (writeFd >= 0) {
+            close(writeFd);
+        }
+        if (in != nullptr) {
+            std::fclose(in);
+        } else {
+            close(client);
+        }
+    }
+    signal(SIGPIPE, previousHandler);
+    close(server);
+    unlink(path.c_str());
+#endif
+}
+
+#endif // MULTIPLETHREAD_QUERY_H
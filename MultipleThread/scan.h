@@ -0,0 +1,343 @@
+#ifndef MULTIPLETHREAD_SCAN_H
+#define MULTIPLETHREAD_SCAN_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MULTIPLETHREAD_SCAN_SSE2 1
+#endif
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "thread_pool.h"
+
+/**
+ * Element-wise outputs over the numbers: prefix sums and k-point moving averages
+ *
+ * A scan is sequential by nature, every output depends on the one before. It is parallelized in two passes:
+ * 1. The array is cut into blocks and every block is summed in parallel.
+ * 2. The block sums are scanned on the calling thread (a few dozen values), which gives every block its carry-in,
+ *    and the blocks are scanned in parallel starting from their carry.
+ * The input is read twice and the output written once, so for arrays much larger than the caches
+ * the scan runs at the speed of memory.
+ *
+ * Within a block the scan uses SSE2: four values are prefix-summed inside the registers with two shifts and adds,
+ * and the carry only has to be added once per four values instead of once per value.
+ * The outputs can be written with streaming (non-temporal) stores, which bypass the caches:
+ * an output written once and not read back would otherwise evict the input and cost a read of every line it writes.
+ *
+ * The k-point moving average is a scan too: the sum of a window is the sum of the previous window
+ * plus the value entering minus the value leaving, so every block computes its first window directly
+ * and scans the differences from there. The window sums are kept in doubles, which is exact
+ * for sums of 32-bit values as long as k·2^31 fits in the 53 bits of the mantissa, i.e. for windows
+ * of at most 2^22 values. Longer windows are rejected, their sums would be rounded.
+ */
+
+/**
+ * A file created with a given size and mapped for writing
+ * The threads write their blocks straight into the page cache, there is no buffer to copy from.
+ */
+class MappedOutput {
+    char *address = nullptr;
+    std::size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+
+public:
+    /**
+     * @param path - The path of the file, replaced if it exists
+     * @param size - The size of the file in bytes
+     */
+    MappedOutput(const std::string &path, std::size_t size) : length(size) {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("Failed to create " + path);
+        }
+        if (length == 0) {
+            return;
+        }
+        LARGE_INTEGER fileSize;
+        fileSize.QuadPart = static_cast<LONGLONG>(length);
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, fileSize.HighPart, fileSize.LowPart, nullptr);
+        if (mapping == nullptr) {
+            CloseHandle(file);
+            throw std::runtime_error("Failed to map " + path);
+        }
+        address = static_cast<char *>(MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0));
+        if (address == nullptr) {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            throw std::runtime_error("Failed to map " + path);
+        }
+#else
+        int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to create " + path);
+        }
+        if (length == 0) {
+            close(fd);
+            return;
+        }
+        if (ftruncate(fd, static_cast<off_t>(length)) != 0) {
+            close(fd);
+            throw std::runtime_error("Failed to resize " + path);
+        }
+        void *mapped = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED) {
+            throw std::runtime_error("Failed to map " + path);
+        }
+        address = static_cast<char *>(mapped);
+#endif
+    }
+
+    ~MappedOutput() {
+#ifdef _WIN32
+        if (address != nullptr) {
+            UnmapViewOfFile(address);
+        }
+        if (mapping != nullptr) {
+            CloseHandle(mapping);
+        }
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+        }
+#else
+        if (address != nullptr) {
+            munmap(address, length);
+        }
+#endif
+    }
+
+    MappedOutput(const MappedOutput &) = delete;
+    MappedOutput &operator=(const MappedOutput &) = delete;
+
+    char *data() { return address; }
+
+    std::size_t size() const { return length; }
+};
+
+/**
+ * Sum a block of values
+ * @param numbers - The values
+ * @param size - The number of values
+ * @return - The sum
+ */
+inline long long blockSum(const int numbers[], std::size_t size) {
+    long long sum = 0;
+    for (std::size_t i = 0; i < size; i++) {
+        sum += numbers[i];
+    }
+    return sum;
+}
+
+/**
+ * Write the inclusive prefix sums of a block
+ * @param numbers - The values
+ * @param out - Receives carry + numbers[0] + ... + numbers[i] at index i
+ * @param size - The number of values
+ * @param carry - The sum of the values before the block
+ * @param streaming - Write with non-temporal stores
+ */
+inline void scanBlock(const int numbers[], long long out[], std::size_t size, long long carry, bool streaming) {
+    std::size_t i = 0;
+#ifdef MULTIPLETHREAD_SCAN_SSE2
+    // Streaming stores need 16-byte aligned addresses, the first values are written one by one until the output is aligned
+    while (i < size && reinterpret_cast<std::uintptr_t>(out + i) % 16 != 0) {
+        carry += numbers[i];
+        out[i++] = carry;
+    }
+    __m128i running = _mm_set1_epi64x(carry);
+    for (; i + 4 <= size; i += 4) {
+        __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i *>(numbers + i));
+        // Sign-extend (a, b, c, d) into (a, b) and (c, d) as 64-bit lanes
+        __m128i sign = _mm_srai_epi32(values, 31);
+        __m128i low = _mm_unpacklo_epi32(values, sign);
+        __m128i high = _mm_unpackhi_epi32(values, sign);
+        // (a, a + b) and (c, c + d)
+        low = _mm_add_epi64(low, _mm_slli_si128(low, 8));
+        high = _mm_add_epi64(high, _mm_slli_si128(high, 8));
+        // (a + b + c, a + b + c + d)
+        high = _mm_add_epi64(high, _mm_shuffle_epi32(low, _MM_SHUFFLE(3, 2, 3, 2)));
+        low = _mm_add_epi64(low, running);
+        high = _mm_add_epi64(high, running);
+        running = _mm_shuffle_epi32(high, _MM_SHUFFLE(3, 2, 3, 2));
+        if (streaming) {
+            _mm_stream_si128(reinterpret_cast<__m128i *>(out + i), low);
+            _mm_stream_si128(reinterpret_cast<__m128i *>(out + i + 2), high);
+        } else {
+            _mm_store_si128(reinterpret_cast<__m128i *>(out + i), low);
+            _mm_store_si128(reinterpret_cast<__m128i *>(out + i + 2), high);
+        }
+    }
+    if (streaming) {
+        // Streaming stores are weakly ordered, make them visible before the task reports that it is done
+        _mm_sfence();
+    }
+    if (i > 0) {
+        carry = out[i - 1];
+    }
+#else
+    (void) streaming;
+#endif
+    for (; i < size; i++) {
+        carry += numbers[i];
+        out[i] = carry;
+    }
+}
+
+/**
+ * The most values a moving average window may cover with exact sums
+ */
+constexpr std::size_t maxMovingAveragePoints = std::size_t(1) << 22;
+
+/**
+ * Write the k-point moving averages of a block
+ * @param numbers - The values, window j covers numbers[j] to numbers[j + k - 1]
+ * @param out - Receives the averages of the windows first to first + size - 1 at out[0] to out[size - 1]
+ * @param first - The first window of the block
+ * @param size - The number of windows
+ * @param k - The number of values per window
+ * @param streaming - Write with non-temporal stores
+ */
+inline void movingAverageBlock(const int numbers[], double out[], std::size_t first, std::size_t size, std::size_t k,
+                               bool streaming) {
+    if (size == 0) {
+        return;
+    }
+    double window = double(blockSum(numbers + first, k));
+    const double points = double(k);
+    out[0] = window / points;
+    // Window j adds numbers[j + k - 1] and drops numbers[j - 1]
+    const int *entering = numbers + first + k;
+    const int *leaving = numbers + first;
+    std::size_t i = 1;
+#ifdef MULTIPLETHREAD_SCAN_SSE2
+    while (i < size && reinterpret_cast<std::uintptr_t>(out + i) % 16 != 0) {
+        window += double(entering[i - 1]) - double(leaving[i - 1]);
+        out[i++] = window / points;
+    }
+    __m128d running = _mm_set1_pd(window);
+    const __m128d divisor = _mm_set1_pd(points);
+    for (; i + 2 <= size; i += 2) {
+        __m128i in = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(entering + i - 1));
+        __m128i out64 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(leaving + i - 1));
+        // (d0, d1) -> (d0, d0 + d1), the differences are whole numbers so the sums stay exact
+        __m128d delta = _mm_sub_pd(_mm_cvtepi32_pd(in), _mm_cvtepi32_pd(out64));
+        delta = _mm_add_pd(delta, _mm_castsi128_pd(_mm_slli_si128(_mm_castpd_si128(delta), 8)));
+        __m128d sums = _mm_add_pd(delta, running);
+        running = _mm_unpackhi_pd(sums, sums);
+        __m128d averages = _mm_div_pd(sums, divisor);
+        if (streaming) {
+            _mm_stream_pd(out + i, averages);
+        } else {
+            _mm_store_pd(out + i, averages);
+        }
+    }
+    if (streaming) {
+        _mm_sfence();
+    }
+    window = _mm_cvtsd_f64(running);
+#else
+    (void) streaming;
+#endif
+    for (; i < size; i++) {
+        window += double(entering[i - 1]) - double(leaving[i - 1]);
+        out[i] = window / points;
+    }
+}
+
+/**
+ * The blocks of a scan: enough to balance the workers, large enough that a block costs more than its task
+ * @param pool - The thread pool
+ * @param size - The number of outputs
+ * @return - The number of outputs per block
+ */
+inline std::size_t scanGrain(const ThreadPool &pool, std::size_t size) {
+    return std::max<std::size_t>(size / (4 * pool.size()) + 1, 65536);
+}
+
+/**
+ * Write the inclusive prefix sums of an array in parallel
+ * @param pool - The thread pool
+ * @param numbers - The values
+ * @param out - Receives numbers[0] + ... + numbers[i] at index i, at least 8-byte aligned
+ * @param size - The number of values
+ * @param streaming - Write with non-temporal stores, for outputs that are not read back soon
+ */
+inline void parallelPrefixSum(ThreadPool &pool, const int numbers[], long long out[], std::size_t size,
+                              bool streaming = false) {
+    if (pool.size() == 1) {
+        // Nothing would run beside the pass that only sums the blocks, a single scan reads the input once
+        scanBlock(numbers, out, size, 0, streaming);
+        return;
+    }
+    std::size_t grain = scanGrain(pool, size);
+    std::size_t blocks = (size + grain - 1) / grain;
+    std::vector<long long> carries(blocks + 1, 0);
+
+    // Pass 1: the sum of every block but the last, nothing depends on the last one
+    pool.parallelFor(0, blocks > 0 ? blocks - 1 : 0, 1, [&](std::size_t first, std::size_t last) {
+        for (std::size_t b = first; b < last; b++) {
+            carries[b + 1] = blockSum(numbers + b * grain, std::min(size, (b + 1) * grain) - b * grain);
+        }
+    });
+    for (std::size_t b = 1; b <= blocks; b++) {
+        carries[b] += carries[b - 1];
+    }
+
+    // Pass 2: every block scans from its carry
+    pool.parallelFor(0, blocks, 1, [&](std::size_t first, std::size_t last) {
+        for (std::size_t b = first; b < last; b++) {
+            std::size_t begin = b * grain;
+            scanBlock(numbers + begin, out + begin, std::min(size, begin + grain) - begin, carries[b], streaming);
+        }
+    });
+}
+
+/**
+ * Write the k-point moving averages of an array in parallel
+ * @param pool - The thread pool
+ * @param numbers - The values
+ * @param out - Receives the average of numbers[j] to numbers[j + k - 1] at index j, size - k + 1 values
+ * @param size - The number of values, at least k
+ * @param k - The number of values per window, between 1 and maxMovingAveragePoints
+ * @param streaming - Write with non-temporal stores, for outputs that are not read back soon
+ */
+inline void parallelMovingAverage(ThreadPool &pool, const int numbers[], double out[], std::size_t size,
+                                  std::size_t k, bool streaming = false) {
+    if (k == 0 || k > size) {
+        throw std::invalid_argument("The moving average needs between 1 and " + std::to_string(size) + " points.");
+    }
+    if (k > maxMovingAveragePoints) {
+        throw std::invalid_argument("The moving average takes at most " + std::to_string(maxMovingAveragePoints) +
+                                    " points.");
+    }
+    std::size_t windows = size - k + 1;
+    // The windows of a block are independent of the other blocks, a single pass is enough
+    std::size_t grain = std::max(scanGrain(pool, windows), 4 * k);
+    pool.parallelFor(0, windows, grain, [&](std::size_t first, std::size_t last) {
+        movingAverageBlock(numbers, out + first, first, last - first, k, streaming);
+    });
+}
+
+#endif // MULTIPLETHREAD_SCAN_H
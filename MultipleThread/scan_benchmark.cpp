@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "scan.h"
+#include "thread_pool.h"
+
+/**
+ * Scan benchmark
+ *
+ * Writes the prefix sums and the 16-point moving averages of an array much larger than the caches
+ * with a growing number of threads and reports the memory traffic in GB/s (values read plus outputs written):
+ * - sequential: std::inclusive_scan into 64-bit sums on the calling thread, the baseline
+ * - prefix: parallelPrefixSum with normal stores
+ * - prefix stream: parallelPrefixSum with streaming stores
+ * - average stream: parallelMovingAverage with streaming stores
+ * The scan should scale until the threads together saturate the memory bandwidth.
+ *
+ * Usage:
+ * ```bash
+ * ./MultipleThreadScanBenchmark [values] [max threads]
+ * ```
+ */
+
+/**
+ * Measure the median time of a computation
+ * @param compute - The computation
+ * @return - The median seconds
+ */
+template<typename Compute>
+double measure(Compute compute) {
+    const int repetitions = 5;
+    std::vector<double> seconds;
+    for (int i = 0; i < repetitions; i++) {
+        auto start = std::chrono::steady_clock::now();
+        compute();
+        auto end = std::chrono::steady_clock::now();
+        seconds.push_back(std::chrono::duration<double>(end - start).count());
+    }
+    std::nth_element(seconds.begin(), seconds.begin() + repetitions / 2, seconds.end());
+    return seconds[repetitions / 2];
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t size = argc > 1 ? std::stoul(argv[1]) : 50000000;
+    unsigned maxThreads = argc > 2 ? static_cast<unsigned>(std::stoul(argv[2])) : std::thread::hardware_concurrency();
+    if (maxThreads == 0) {
+        maxThreads = 1;
+    }
+    const std::size_t k = 16;
+
+    std::vector<int> numbers(size);
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> distribution(-1000000, 1000000);
+    for (auto &number: numbers) {
+        number = distribution(gen);
+    }
+    // The outputs are written once before timing, so no measurement pays for the page faults
+    std::vector<long long> sums(size, 0);
+    std::vector<double> averages(size, 0);
+    std::vector<long long> expected(size);
+    // partial_sum would accumulate in int, inclusive_scan accumulates in the type of its initial value
+    std::inclusive_scan(numbers.begin(), numbers.end(), expected.begin(), std::plus<>(), 0LL);
+
+    double prefixBytes = double(size) * (sizeof(int) + sizeof(long long));
+    double averageBytes = double(size) * (sizeof(int) + sizeof(double));
+    double sequential = measure([&] {
+        std::inclusive_scan(numbers.begin(), numbers.end(), sums.begin(), std::plus<>(), 0LL);
+    });
+    std::cout << "GB/s for " << size << " values, sequential inclusive_scan " << std::fixed << std::setprecision(2)
+              << prefixBytes / sequential / 1e9 << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(14) << "prefix" << std::setw(16) << "prefix stream"
+              << std::setw(16) << "average stream" << std::endl;
+
+    for (unsigned threads = 1; threads <= maxThreads; threads = threads < maxThreads ? std::min(2 * threads, maxThreads)
+                                                                                     : threads + 1) {
+        ThreadPool pool(threads);
+        double prefix = measure([&] { parallelPrefixSum(pool, numbers.data(), sums.data(), size, false); });
+        bool correct = sums == expected;
+        double stream = measure([&] { parallelPrefixSum(pool, numbers.data(), sums.data(), size, true); });
+        correct = correct && sums == expected;
+        double average = measure([&] {
+            parallelMovingAverage(pool, numbers.data(), averages.data(), size, k, true);
+        });
+        correct = correct && averages[size - k] == double(expected[size - 1] - expected[size - k - 1]) / k;
+
+        std::cout << std::setw(8) << threads << std::setw(14) << prefixBytes / prefix / 1e9 << std::setw(16)
+                  << prefixBytes / stream / 1e9 << std::setw(16) << averageBytes / average / 1e9
+                  << (correct ? "" : "  wrong result") << std::endl;
+    }
+    return 0;
+}
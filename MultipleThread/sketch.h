@@ -0,0 +1,524 @@
+#ifndef MULTIPLETHREAD_SKETCH_H
+#define MULTIPLETHREAD_SKETCH_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <climits>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "statistics.h"
+
+/**
+ * Sketches: small, mergeable summaries of inputs too large to keep
+ *
+ * The number of distinct values and the most frequent values cannot be computed exactly without remembering
+ * every value. A sketch answers approximately in a fixed amount of memory chosen up front, and two sketches
+ * of two parts of the input merge into the sketch of the whole input, so every worker can build its own
+ * and the results are merged at the end like the Statistics.
+ * - HyperLogLog: the number of distinct values, standard error 1.04 / sqrt(2^precision)
+ * - Count-Min: the frequency of any value, overestimated by at most epsilon * N with probability 1 - delta
+ * - Space-Saving: the values seen most often, every count overestimated by at most N / capacity
+ */
+
+/**
+ * Mix the bits of a value into a 64-bit hash (splitmix64)
+ * @param value - The value
+ * @return - The hash
+ */
+inline std::uint64_t hashValue(long long value) {
+    std::uint64_t x = static_cast<std::uint64_t>(value) + 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+/**
+ * Count the leading zero bits
+ * @param x - The value, not zero
+ * @return - The number of zero bits above the highest set bit
+ */
+inline unsigned leadingZeros(std::uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_clzll(x));
+#else
+    unsigned n = 0;
+    while (!(x & (std::uint64_t(1) << 63))) {
+        x <<= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/**
+ * HyperLogLog distinct counter
+ * The first `precision` bits of the hash choose a register, which keeps the longest run of leading zeros
+ * seen in the remaining bits. A run of r zeros takes about 2^r distinct values to appear.
+ */
+class HyperLogLog {
+    unsigned precision;
+    std::vector<std::uint8_t> registers;
+
+public:
+    /**
+     * @param precision - Between 4 and 18, uses 2^precision bytes
+     */
+    explicit HyperLogLog(unsigned precision = 14) : precision(precision) {
+        if (precision < 4 || precision > 18) {
+            throw std::invalid_argument("The HyperLogLog precision must be between 4 and 18.");
+        }
+        registers.assign(std::size_t(1) << precision, 0);
+    }
+
+    /**
+     * Add a hashed value
+     * @param hash - The hash of the value
+     */
+    void add(std::uint64_t hash) {
+        std::size_t index = hash >> (64 - precision);
+        // The guard bit stops the run of zeros before the register bits
+        std::uint64_t rest = (hash << precision) | (std::uint64_t(1) << (precision - 1));
+        auto rank = static_cast<std::uint8_t>(leadingZeros(rest) + 1);
+        registers[index] = std::max(registers[index], rank);
+    }
+
+    /**
+     * Merge the sketch of another part of the input
+     * @param other - A sketch with the same precision
+     */
+    void merge(const HyperLogLog &other) {
+        if (other.precision != precision) {
+            throw std::invalid_argument("Only sketches of the same precision can be merged.");
+        }
+        for (std::size_t i = 0; i < registers.size(); i++) {
+            registers[i] = std::max(registers[i], other.registers[i]);
+        }
+    }
+
+    /**
+     * @return - The estimated number of distinct values
+     */
+    double estimate() const {
+        double m = double(registers.size());
+        double sum = 0;
+        std::size_t zeros = 0;
+        for (std::uint8_t r: registers) {
+            sum += std::ldexp(1.0, -int(r));
+            zeros += r == 0;
+        }
+        double alpha = registers.size() >= 128 ? 0.7213 / (1 + 1.079 / m) : registers.size() >= 64 ? 0.709 : 0.697;
+        double estimate = alpha * m * m / sum;
+        // Few values: count the empty registers instead (linear counting)
+        if (estimate <= 2.5 * m && zeros > 0) {
+            estimate = m * std::log(m / double(zeros));
+        }
+        return estimate;
+    }
+
+    /**
+     * @return - The relative standard error of the estimate
+     */
+    double standardError() const { return 1.04 / std::sqrt(double(registers.size())); }
+
+    std::size_t memory() const { return registers.size(); }
+};
+
+/**
+ * Count-Min frequency sketch
+ * Every row counts the values in `width` counters chosen by a different hash, collisions only add,
+ * so the smallest of the rows' counters is the best estimate of a frequency.
+ */
+class CountMinSketch {
+    std::size_t width;
+    std::size_t depth;
+    std::vector<std::uint64_t> counters;
+
+public:
+    /**
+     * @param epsilon - The error of an estimate, as a fraction of the number of values added
+     * @param delta - The probability of exceeding that error
+     */
+    explicit CountMinSketch(double epsilon = 0.001, double delta = 0.01) {
+        if (!(epsilon > 0 && epsilon < 1 && delta > 0 && delta < 1)) {
+            throw std::invalid_argument("The sketch error and probability must be between 0 and 1.");
+        }
+        // A power of two, so that the column is a mask of the hash
+        width = 1;
+        while (double(width) < std::exp(1.0) / epsilon) {
+            width *= 2;
+        }
+        depth = static_cast<std::size_t>(std::ceil(std::log(1 / delta)));
+        counters.assign(width * depth, 0);
+    }
+
+    /**
+     * Count a hashed value
+     * @param hash - The hash of the value
+     * @param count - How often it was seen
+     */
+    void add(std::uint64_t hash, std::uint64_t count = 1) {
+        // The rows use the hashes h1 + row * h2 (Kirsch and Mitzenmacher)
+        std::uint64_t h1 = hash & 0xFFFFFFFF;
+        std::uint64_t h2 = (hash >> 32) | 1;
+        for (std::size_t row = 0; row < depth; row++) {
+            counters[row * width + ((h1 + row * h2) & (width - 1))] += count;
+        }
+    }
+
+    /**
+     * @param hash - The hash of a value
+     * @return - An upper bound of its frequency
+     */
+    std::uint64_t estimate(std::uint64_t hash) const {
+        std::uint64_t h1 = hash & 0xFFFFFFFF;
+        std::uint64_t h2 = (hash >> 32) | 1;
+        std::uint64_t result = UINT64_MAX;
+        for (std::size_t row = 0; row < depth; row++) {
+            result = std::min(result, counters[row * width + ((h1 + row * h2) & (width - 1))]);
+        }
+        return result;
+    }
+
+    /**
+     * Merge the sketch of another part of the input
+     * @param other - A sketch with the same dimensions
+     */
+    void merge(const CountMinSketch &other) {
+        if (other.width != width || other.depth != depth) {
+            throw std::invalid_argument("Only sketches of the same size can be merged.");
+        }
+        for (std::size_t i = 0; i < counters.size(); i++) {
+            counters[i] += other.counters[i];
+        }
+    }
+
+    std::size_t memory() const { return counters.size() * sizeof(std::uint64_t); }
+};
+
+/**
+ * Space-Saving heavy hitters (Metwally et al.)
+ * Keeps `capacity` counters. A value without a counter takes over the smallest one, inheriting its count
+ * as the possible error. The counters are kept in a "stream summary": the counters of equal count form a bucket,
+ * and the buckets form a list sorted by count, so the smallest counter is the first of the first bucket
+ * and an increment moves a counter to the next bucket, both in O(1) even when many counts are tied.
+ * An open-addressing table maps a value to its counter without allocating.
+ */
+class SpaceSaving {
+public:
+    struct Counter {
+        long long value;
+        std::uint64_t count;  // Upper bound of the frequency
+        std::uint64_t error;  // count - error is a lower bound
+    };
+
+private:
+    static constexpr std::uint32_t none = UINT32_MAX;
+
+    struct Slot {
+        Counter counter;
+        std::uint32_t bucket;
+        std::uint32_t prev;   // Neighbours in the bucket
+        std::uint32_t next;
+    };
+
+    struct Bucket {
+        std::uint64_t count;
+        std::uint32_t first;  // First slot
+        std::uint32_t prev;   // Neighbours in the list of buckets, by increasing count
+        std::uint32_t next;
+    };
+
+    std::size_t capacity;
+    std::vector<Slot> slots;
+    std::vector<Bucket> buckets;
+    std::vector<std::uint32_t> freeBuckets;
+    std::uint32_t lowest = none;
+    std::uint32_t highest = none;
+    std::vector<std::uint32_t> table;     // Linear probing table of slots, keyed by their value
+    std::size_t mask;
+
+    std::size_t home(long long value) const { return hashValue(value) & mask; }
+
+    /**
+     * Find the table entry of a value
+     * @param value - The value
+     * @return - Its entry, or the empty entry where it would go
+     */
+    std::size_t find(long long value) const {
+        std::size_t i = home(value);
+        while (table[i] != none && slots[table[i]].counter.value != value) {
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    /**
+     * Remove a table entry, moving back the entries after it that would not be found past the gap
+     * @param i - The entry
+     */
+    void erase(std::size_t i) {
+        std::size_t j = i;
+        while (true) {
+            j = (j + 1) & mask;
+            if (table[j] == none) {
+                break;
+            }
+            std::size_t k = home(slots[table[j]].counter.value);
+            // Move entry j into the gap unless its home lies cyclically in (i, j]
+            if ((j > i && (k <= i || k > j)) || (j < i && k <= i && k > j)) {
+                table[i] = table[j];
+                i = j;
+            }
+        }
+        table[i] = none;
+    }
+
+    /**
+     * Take a slot out of its bucket, the bucket stays in the list even if it becomes empty
+     * @param s - The slot
+     */
+    void unlink(std::uint32_t s) {
+        Slot &slot = slots[s];
+        if (slot.prev != none) {
+            slots[slot.prev].next = slot.next;
+        } else {
+            buckets[slot.bucket].first = slot.next;
+        }
+        if (slot.next != none) {
+            slots[slot.next].prev = slot.prev;
+        }
+    }
+
+    /**
+     * Remove a bucket from the list if it has no slots left
+     * @param b - The bucket
+     */
+    void releaseIfEmpty(std::uint32_t b) {
+        Bucket &bucket = buckets[b];
+        if (bucket.first != none) {
+            return;
+        }
+        (bucket.prev != none ? buckets[bucket.prev].next : lowest) = bucket.next;
+        (bucket.next != none ? buckets[bucket.next].prev : highest) = bucket.prev;
+        freeBuckets.push_back(b);
+    }
+
+    /**
+     * Put a slot into the bucket of its count
+     * @param s - The slot, not in any bucket
+     * @param from - A bucket whose count is at most the slot's, where the search starts, or none for the first one
+     */
+    void place(std::uint32_t s, std::uint32_t from) {
+        std::uint64_t count = slots[s].counter.count;
+        std::uint32_t before = from;
+        std::uint32_t after = from == none ? lowest : buckets[from].next;
+        while (after != none && buckets[after].count <= count) {
+            before = after;
+            after = buckets[after].next;
+        }
+
+        std::uint32_t target = before;
+        if (before == none || buckets[before].count != count) {
+            if (freeBuckets.empty()) {
+                target = static_cast<std::uint32_t>(buckets.size());
+                buckets.push_back({});
+            } else {
+                target = freeBuckets.back();
+                freeBuckets.pop_back();
+            }
+            buckets[target] = {count, none, before, after};
+            (before != none ? buckets[before].next : lowest) = target;
+            (after != none ? buckets[after].prev : highest) = target;
+        }
+
+        Slot &slot = slots[s];
+        slot.bucket = target;
+        slot.prev = none;
+        slot.next = buckets[target].first;
+        if (slot.next != none) {
+            slots[slot.next].prev = s;
+        }
+        buckets[target].first = s;
+    }
+
+public:
+    /**
+     * @param capacity - The number of counters, the counts are off by at most N / capacity
+     */
+    explicit SpaceSaving(std::size_t capacity = 1000) : capacity(std::max<std::size_t>(capacity, 1)) {
+        std::size_t size = 1;
+        while (size < 2 * this->capacity) {
+            size *= 2;
+        }
+        table.assign(size, none);
+        mask = size - 1;
+        slots.reserve(this->capacity);
+    }
+
+    /**
+     * Count a value
+     * @param value - The value
+     * @param count - How often it was seen
+     * @param error - The error already in count
+     */
+    void add(long long value, std::uint64_t count = 1, std::uint64_t error = 0) {
+        std::size_t entry = find(value);
+        if (table[entry] != none) {
+            std::uint32_t s = table[entry];
+            std::uint32_t old = slots[s].bucket;
+            slots[s].counter.count += count;
+            slots[s].counter.error += error;
+            unlink(s);
+            place(s, old);
+            releaseIfEmpty(old);
+        } else if (slots.size() < capacity) {
+            auto s = static_cast<std::uint32_t>(slots.size());
+            slots.push_back({{value, count, error}, none, none, none});
+            table[entry] = s;
+            // Merges add their counters from the smallest up, start from the end in that case
+            place(s, highest != none && buckets[highest].count <= count ? highest : none);
+        } else {
+            std::uint32_t old = lowest;
+            std::uint32_t s = buckets[old].first;
+            Counter &smallest = slots[s].counter;
+            erase(find(smallest.value));
+            smallest = {value, smallest.count + count, smallest.count + error};
+            table[find(value)] = s;
+            unlink(s);
+            place(s, old);
+            releaseIfEmpty(old);
+        }
+    }
+
+    /**
+     * @return - The count a value without a counter may have had, 0 while not all counters are used
+     */
+    std::uint64_t minimum() const { return slots.size() < capacity ? 0 : buckets[lowest].count; }
+
+    /**
+     * Merge the summary of another part of the input (Agarwal et al.)
+     * A value missing from one summary may have been counted up to that summary's minimum there.
+     *
+     * @param other - The other summary
+     */
+    void merge(const SpaceSaving &other) {
+        std::uint64_t ownMinimum = minimum();
+        std::uint64_t otherMinimum = other.minimum();
+        std::vector<Counter> combined;
+        for (const auto &slot: slots) {
+            const Counter &counter = slot.counter;
+            std::size_t entry = other.find(counter.value);
+            if (other.table[entry] != none) {
+                const Counter &match = other.slots[other.table[entry]].counter;
+                combined.push_back({counter.value, counter.count + match.count, counter.error + match.error});
+            } else {
+                combined.push_back({counter.value, counter.count + otherMinimum, counter.error + otherMinimum});
+            }
+        }
+        for (const auto &slot: other.slots) {
+            const Counter &counter = slot.counter;
+            if (table[find(counter.value)] == none) {
+                combined.push_back({counter.value, counter.count + ownMinimum, counter.error + ownMinimum});
+            }
+        }
+
+        std::size_t keep = std::min(capacity, combined.size());
+        std::partial_sort(combined.begin(), combined.begin() + keep, combined.end(),
+                          [](const Counter &a, const Counter &b) { return a.count > b.count; });
+        slots.clear();
+        buckets.clear();
+        freeBuckets.clear();
+        lowest = none;
+        highest = none;
+        std::fill(table.begin(), table.end(), none);
+        for (std::size_t i = keep; i-- > 0;) {
+            add(combined[i].value, combined[i].count, combined[i].error);
+        }
+    }
+
+    /**
+     * @param k - The number of values
+     * @return - The k values with the highest counts, the highest first
+     */
+    std::vector<Counter> top(std::size_t k) const {
+        std::vector<Counter> result;
+        for (std::uint32_t b = highest; b != none && result.size() < k; b = buckets[b].prev) {
+            for (std::uint32_t s = buckets[b].first; s != none && result.size() < k; s = slots[s].next) {
+                result.push_back(slots[s].counter);
+            }
+        }
+        return result;
+    }
+
+    std::size_t memory() const {
+        return capacity * (sizeof(Slot) + sizeof(Bucket)) + table.size() * sizeof(std::uint32_t);
+    }
+};
+
+/**
+ * The sizes of the sketches
+ */
+struct SketchOptions {
+    bool distinct = false;     // Build a HyperLogLog
+    std::size_t top = 0;       // Report the top values, 0 for no Count-Min and Space-Saving
+    unsigned precision = 14;   // HyperLogLog precision
+    double epsilon = 0.001;    // Count-Min error and 1 / Space-Saving capacity
+    double delta = 0.01;       // Count-Min failure probability
+};
+
+/**
+ * The statistics of a part of the input together with its sketches
+ * It can be used wherever blocks are reduced into Statistics (see reduceBlocks).
+ */
+struct SketchSummary {
+    SketchOptions options;
+    Statistics stats;
+    HyperLogLog distinct;
+    CountMinSketch frequency;
+    SpaceSaving heavy;
+
+    explicit SketchSummary(const SketchOptions &options = SketchOptions())
+            : options(options), distinct(options.distinct ? options.precision : 4),
+              frequency(options.top > 0 ? options.epsilon : 0.5, options.top > 0 ? options.delta : 0.5),
+              heavy(options.top > 0 ? std::max(options.top, std::size_t(std::ceil(1 / options.epsilon))) : 1) {}
+
+    /**
+     * Add an array of values
+     * @param numbers - The values
+     * @param size - The number of values
+     */
+    void add(const int numbers[], std::size_t size) {
+        stats.add(numbers, size);
+        if (options.distinct) {
+            for (std::size_t i = 0; i < size; i++) {
+                distinct.add(hashValue(numbers[i]));
+            }
+        }
+        if (options.top > 0) {
+            for (std::size_t i = 0; i < size; i++) {
+                frequency.add(hashValue(numbers[i]));
+                heavy.add(numbers[i]);
+            }
+        }
+    }
+
+    /**
+     * Merge the summary of another part of the input
+     * @param other - A summary built with the same options
+     */
+    void merge(const SketchSummary &other) {
+        stats.merge(other.stats);
+        if (options.distinct) {
+            distinct.merge(other.distinct);
+        }
+        if (options.top > 0) {
+            frequency.merge(other.frequency);
+            heavy.merge(other.heavy);
+        }
+    }
+};
+
+#endif // MULTIPLETHREAD_SKETCH_H
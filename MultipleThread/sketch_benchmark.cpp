@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "sketch.h"
+#include "thread_pool.h"
+
+/**
+ * Sketch benchmark
+ *
+ * Counts the distinct values and the top 10 values of a skewed (Zipf) and of a uniform input:
+ * - exact: an unordered_map from every value to its count, on one thread
+ * - sketch: a SketchSummary (HyperLogLog, Count-Min and Space-Saving) on one thread
+ * - sketch pool: one SketchSummary per chunk on a thread pool, merged
+ * and reports the throughput, the memory of the counts, the relative error of the distinct count,
+ * the fraction of the true top 10 that was found and the largest relative error of their counts.
+ *
+ * Usage:
+ * ```bash
+ * ./MultipleThreadSketchBenchmark [values] [threads] [sketch error]
+ * ```
+ */
+
+/**
+ * The answers of one method
+ */
+struct Answer {
+    double distinct;
+    std::vector<std::pair<long long, std::uint64_t>> top;
+    std::size_t memory;
+};
+
+/**
+ * Generate the values of a Zipf distribution
+ * @param size - The number of values
+ * @param universe - The number of possible values
+ * @param exponent - The skew, the k-th most frequent value is seen about k^-exponent as often as the first
+ * @return - The values
+ */
+std::vector<int> zipf(std::size_t size, std::size_t universe, double exponent) {
+    std::vector<double> cumulative(universe);
+    double sum = 0;
+    for (std::size_t k = 0; k < universe; k++) {
+        sum += 1 / std::pow(double(k + 1), exponent);
+        cumulative[k] = sum;
+    }
+    std::mt19937_64 gen(42);
+    std::uniform_real_distribution<double> uniform(0, sum);
+    std::vector<int> values(size);
+    for (auto &value: values) {
+        auto k = std::lower_bound(cumulative.begin(), cumulative.end(), uniform(gen)) - cumulative.begin();
+        // Spread the ranks over the int range so that the most frequent values are not just 0, 1, 2, ...
+        value = static_cast<int>(static_cast<std::uint32_t>(std::uint64_t(k) * 2654435761ULL));
+    }
+    return values;
+}
+
+/**
+ * Run a method and time it
+ * @param seconds - Receives the elapsed time
+ * @param method - The method
+ * @return - Its answer
+ */
+template<typename Method>
+Answer timed(double &seconds, Method method) {
+    auto start = std::chrono::steady_clock::now();
+    Answer answer = method();
+    auto end = std::chrono::steady_clock::now();
+    seconds = std::chrono::duration<double>(end - start).count();
+    return answer;
+}
+
+/**
+ * Read the answers of a summary
+ * @param summary - The merged summary
+ * @param k - The number of top values
+ * @return - The answers
+ */
+Answer sketchAnswer(const SketchSummary &summary, std::size_t k) {
+    Answer answer;
+    answer.distinct = summary.distinct.estimate();
+    for (const auto &counter: summary.heavy.top(k)) {
+        answer.top.emplace_back(counter.value,
+                                std::min(counter.count, summary.frequency.estimate(hashValue(counter.value))));
+    }
+    answer.memory = summary.distinct.memory() + summary.frequency.memory() + summary.heavy.memory();
+    return answer;
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t size = argc > 1 ? std::stoul(argv[1]) : 10000000;
+    unsigned threads = argc > 2 ? static_cast<unsigned>(std::stoul(argv[2])) : std::thread::hardware_concurrency();
+    if (threads == 0) {
+        threads = 1;
+    }
+    ThreadPool pool(threads);
+    const std::size_t k = 10;
+    SketchOptions options;
+    options.distinct = true;
+    options.top = k;
+    if (argc > 3) {
+        options.epsilon = std::stod(argv[3]);
+    }
+
+    std::cout << size << " values, " << threads << " thread(s), top " << k << ", sketch error " << options.epsilon
+              << std::endl;
+    std::cout << std::setw(10) << "input" << std::setw(14) << "method" << std::setw(14) << "Mvalues/s"
+              << std::setw(14) << "memory KiB" << std::setw(16) << "distinct err %" << std::setw(12) << "top recall"
+              << std::setw(16) << "count err %" << std::endl;
+
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> uniform(0, 99999999);
+    std::vector<std::pair<std::string, std::vector<int>>> inputs;
+    inputs.emplace_back("zipf", zipf(size, 1000000, 1.1));
+    std::vector<int> flat(size);
+    for (auto &value: flat) {
+        value = uniform(gen);
+    }
+    inputs.emplace_back("uniform", std::move(flat));
+
+    for (const auto &input: inputs) {
+        const std::vector<int> &values = input.second;
+
+        double exactSeconds;
+        Answer exact = timed(exactSeconds, [&] {
+            std::unordered_map<int, std::uint64_t> counts;
+            for (int value: values) {
+                counts[value]++;
+            }
+            Answer answer;
+            answer.distinct = double(counts.size());
+            std::vector<std::pair<long long, std::uint64_t>> all(counts.begin(), counts.end());
+            std::size_t keep = std::min(k, all.size());
+            std::partial_sort(all.begin(), all.begin() + keep, all.end(),
+                              [](const std::pair<long long, std::uint64_t> &a,
+                                 const std::pair<long long, std::uint64_t> &b) { return a.second > b.second; });
+            all.resize(keep);
+            answer.top = all;
+            // A node per value plus the bucket array
+            answer.memory = counts.size() * (sizeof(std::pair<const int, std::uint64_t>) + sizeof(void *) + 8) +
+                            counts.bucket_count() * sizeof(void *);
+            return answer;
+        });
+
+        double singleSeconds;
+        Answer single = timed(singleSeconds, [&] {
+            SketchSummary summary(options);
+            summary.add(values.data(), values.size());
+            return sketchAnswer(summary, k);
+        });
+
+        double poolSeconds;
+        Answer parallel = timed(poolSeconds, [&] {
+            SketchSummary identity(options);
+            SketchSummary summary = pool.parallelReduce(
+                    std::size_t(0), values.size(), values.size() / threads + 1, identity,
+                    [&](std::size_t begin, std::size_t end) {
+                        SketchSummary part(options);
+                        part.add(values.data() + begin, end - begin);
+                        return part;
+                    },
+                    [](SketchSummary &result, const SketchSummary &part) { result.merge(part); });
+            return sketchAnswer(summary, k);
+        });
+
+        auto report = [&](const char *method, double seconds, const Answer &answer) {
+            std::unordered_map<long long, std::uint64_t> truth(exact.top.begin(), exact.top.end());
+            std::size_t found = 0;
+            double countError = 0;
+            for (const auto &entry: answer.top) {
+                auto it = truth.find(entry.first);
+                if (it != truth.end()) {
+                    found++;
+                    countError = std::max(countError, std::abs(double(entry.second) - double(it->second)) /
+                                                      double(it->second));
+                }
+            }
+            std::cout << std::setw(10) << input.first << std::setw(14) << method << std::fixed
+                      << std::setprecision(2) << std::setw(14) << double(values.size()) / seconds / 1e6
+                      << std::setw(14) << double(answer.memory) / 1024 << std::setprecision(3) << std::setw(16)
+                      << 100 * std::abs(answer.distinct - exact.distinct) / exact.distinct << std::setw(12)
+                      << double(found) / double(exact.top.size()) << std::setw(16) << 100 * countError << std::endl;
+        };
+        report("exact", exactSeconds, exact);
+        report("sketch", singleSeconds, single);
+        report("sketch pool", poolSeconds, parallel);
+    }
+    return 0;
+}
@@ -0,0 +1,273 @@
+#ifndef MULTIPLETHREAD_SLIDING_WINDOW_H
+#define MULTIPLETHREAD_SLIDING_WINDOW_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "input.h"
+#include "thread_pool.h"
+
+/**
+ * Sliding-window statistics over a continuous stream
+ *
+ * Instead of one result over a fixed list, the average, minimum and maximum are kept up to date
+ * over the last N values and/or the values of the last T seconds, after every new value.
+ *
+ * - The sum of the window is updated when a value enters and when it leaves, so the average is O(1).
+ * - The minimum is the front of a deque whose values increase from front to back:
+ *   a new value removes every value at the back that is not smaller, because those can never be the minimum again
+ *   while the new value is in the window. Every value is pushed and popped at most once, O(1) amortized.
+ *   The maximum uses a deque whose values decrease.
+ */
+class SlidingWindow {
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    struct Entry {
+        int value;
+        long long sequence;
+        Clock::time_point time;
+    };
+
+    std::deque<Entry> values;
+    std::deque<Entry> minimums;
+    std::deque<Entry> maximums;
+    long long sum = 0;
+    long long nextSequence = 0;
+    std::size_t capacity;
+    Clock::duration span;
+
+    /**
+     * Remove the oldest value
+     */
+    void popFront() {
+        const Entry &oldest = values.front();
+        sum -= oldest.value;
+        if (minimums.front().sequence == oldest.sequence) {
+            minimums.pop_front();
+        }
+        if (maximums.front().sequence == oldest.sequence) {
+            maximums.pop_front();
+        }
+        values.pop_front();
+    }
+
+public:
+    /**
+     * @param capacity - The number of values in the window, 0 for no limit
+     * @param span - The age of the oldest value in the window, zero for no limit
+     */
+    SlidingWindow(std::size_t capacity, Clock::duration span) : capacity(capacity), span(span) {}
+
+    /**
+     * Add a new value and drop the values that left the window
+     * @param value - The value
+     * @param now - The arrival time of the value
+     */
+    void push(int value, Clock::time_point now) {
+        Entry entry = {value, nextSequence++, now};
+        values.push_back(entry);
+        sum += value;
+        while (!minimums.empty() && minimums.back().value >= value) {
+            minimums.pop_back();
+        }
+        minimums.push_back(entry);
+        while (!maximums.empty() && maximums.back().value <= value) {
+            maximums.pop_back();
+        }
+        maximums.push_back(entry);
+
+        if (capacity > 0 && values.size() > capacity) {
+            popFront();
+        }
+        expire(now);
+    }
+
+    /**
+     * Drop the values that are older than the span
+     * @param now - The current time
+     */
+    void expire(Clock::time_point now) {
+        if (span == Clock::duration::zero()) {
+            return;
+        }
+        while (!values.empty() && now - values.front().time > span) {
+            popFront();
+        }
+    }
+
+    std::size_t size() const { return values.size(); }
+
+    bool empty() const { return values.empty(); }
+
+    double average() const { return double(sum) / double(values.size()); }
+
+    int min() const { return minimums.front().value; }
+
+    int max() const { return maximums.front().value; }
+};
+
+/**
+ * The options of the streaming mode
+ */
+struct WindowOptions {
+    std::size_t capacity = 0;                   // --window N
+    SlidingWindow::Clock::duration span{};      // --window-seconds T
+    std::size_t snapshotEvery = 0;              // --snapshot-every K values
+    std::chrono::milliseconds snapshotInterval{1000};  // --snapshot-ms M
+    InputFormat format = InputFormat::Text;
+    std::size_t blockSize = 1 << 16;
+};
+
+/**
+ * Calculate sliding-window statistics over a stream until it ends
+ *
+ * A reader thread reads whatever the stream has available and submits each block to the thread pool for parsing,
+ * so the parsing is sharded over the workers. The calling thread takes the parsed blocks back in their original order
+ * and pushes the values into the window, which is inherently sequential but only costs a few operations per value.
+ * A snapshot line (elapsed milliseconds, count, average, minimum, maximum) is written every `snapshotEvery` values
+ * and whenever `snapshotInterval` has passed, even while no new values arrive.
+ *
+ * @param pool - The thread pool parsing the blocks
+ * @param file - The stream, e.g. stdin
+ * @param options - The window and snapshot options
+ * @param out - Where to write the snapshots
+ * @return - The number of values read
+ */
+inline long long streamWindow(ThreadPool &pool, std::FILE *file, const WindowOptions &options, std::ostream &out) {
+    using Clock = SlidingWindow::Clock;
+
+    struct Parsed {
+        std::future<std::vector<int>> values;
+        Clock::time_point arrival;
+    };
+    std::deque<Parsed> inFlight;
+    std::mutex mtx;
+    std::condition_variable changed;
+    bool finished = false;
+    std::exception_ptr readError;
+    const std::size_t maxInFlight = 2 * pool.size() + 2;
+
+    std::thread reader([&] {
+        try {
+            StreamReader stream(file, options.blockSize, options.format, true);
+            Block block;
+            while (stream.next(block)) {
+                Clock::time_point arrival = Clock::now();
+                auto input = std::make_shared<Block>(std::move(block));
+                auto parsed = pool.submit([input, format = options.format] {
+                    std::vector<int> numbers;
+                    if (format == InputFormat::Text) {
+                        parseText(input->data, input->data + input->size,
+                                  [&numbers](int value) { numbers.push_back(value); });
+                    } else {
+                        for (std::size_t i = 0; i + 4 <= input->size; i += 4) {
+                            numbers.push_back(decodeInt32(input->data + i));
+                        }
+                    }
+                    return numbers;
+                });
+
+                std::unique_lock<std::mutex> lock(mtx);
+                while (inFlight.size() >= maxInFlight) {
+                    changed.wait(lock);
+                }
+                inFlight.push_back({std::move(parsed), arrival});
+                changed.notify_all();
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mtx);
+            readError = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(mtx);
+        finished = true;
+        changed.notify_all();
+    });
+
+    SlidingWindow window(options.capacity, options.span);
+    Clock::time_point start = Clock::now();
+    Clock::time_point lastSnapshot = start;
+    std::size_t sinceSnapshot = 0;
+    long long total = 0;
+
+    auto snapshot = [&](Clock::time_point now) {
+        window.expire(now);
+        out << std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count() << ","
+            << window.size() << ",";
+        if (!window.empty()) {
+            out << window.average() << "," << window.min() << "," << window.max();
+        } else {
+            out << ",,";
+        }
+        out << "\n";
+        lastSnapshot = now;
+        sinceSnapshot = 0;
+    };
+
+    out << "elapsed_ms,count,average,min,max\n";
+    std::exception_ptr parseError;
+    while (true) {
+        Parsed next;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            while (inFlight.empty() && !finished) {
+                if (changed.wait_until(lock, lastSnapshot + options.snapshotInterval) == std::cv_status::timeout) {
+                    lock.unlock();
+                    snapshot(Clock::now());
+                    out.flush();
+                    lock.lock();
+                }
+            }
+            if (inFlight.empty()) {
+                break;
+            }
+            next = std::move(inFlight.front());
+            inFlight.pop_front();
+            changed.notify_all();
+        }
+
+        std::vector<int> numbers;
+        try {
+            numbers = pool.wait(next.values);
+        } catch (...) {
+            // Keep taking the blocks so that the reader is never stuck on a full queue
+            parseError = parseError ? parseError : std::current_exception();
+            continue;
+        }
+        for (int value: numbers) {
+            window.push(value, next.arrival);
+            total++;
+            if (options.snapshotEvery > 0 && ++sinceSnapshot >= options.snapshotEvery) {
+                snapshot(next.arrival);
+            }
+        }
+        Clock::time_point now = Clock::now();
+        if (now - lastSnapshot >= options.snapshotInterval) {
+            snapshot(now);
+            out.flush();
+        }
+    }
+    reader.join();
+    snapshot(Clock::now());
+    out.flush();
+
+    if (readError) {
+        std::rethrow_exception(readError);
+    }
+    if (parseError) {
+        std::rethrow_exception(parseError);
+    }
+    return total;
+}
+
+#endif // MULTIPLETHREAD_SLIDING_WINDOW_H
@@ -0,0 +1,178 @@
+#ifndef MULTIPLETHREAD_STATISTICS_H
+#define MULTIPLETHREAD_STATISTICS_H
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+#include "thread_pool.h"
+
+/**
+ * The type of an exact sum of values of type T
+ * The sum of 32-bit values is kept in 64 bits, the sum of 64-bit values in 128 bits where the compiler has them.
+ */
+template<typename T>
+struct SumType {
+    using type = long long;
+};
+
+template<>
+struct SumType<long long> {
+#ifdef __SIZEOF_INT128__
+    using type = __int128;
+#else
+    using type = long double;
+#endif
+};
+
+/**
+ * Partial statistics over a part of the input.
+ *
+ * Every worker thread reduces the blocks it receives into its own Statistics,
+ * the parent thread merges them once the workers have exited.
+ *
+ * - The sum is exact: a sum of 32-bit values cannot overflow before 2^32 values have been added.
+ * - The variance is tracked with Welford's algorithm: the running mean and the sum of squared
+ *   differences from it (m2), which does not lose precision the way sum(x^2) - sum(x)^2 / n does.
+ * - Two partial results are merged with the parallel formula of Chan et al.,
+ *   so the variance comes out of the same single pass as the average, minimum and maximum.
+ */
+template<typename T>
+struct BasicStatistics {
+    using Sum = typename SumType<T>::type;
+
+    long long count = 0;
+    Sum sum = 0;
+    T min = std::numeric_limits<T>::max();
+    T max = std::numeric_limits<T>::lowest();
+    double mean = 0;
+    double m2 = 0;
+
+    /**
+     * Add a single value
+     * @param value - The value to add
+     */
+    void add(T value) {
+        count++;
+        sum += value;
+        if (value < min) {
+            min = value;
+        }
+        if (value > max) {
+            max = value;
+        }
+        double delta = double(value) - mean;
+        mean += delta / double(count);
+        m2 += delta * (double(value) - mean);
+    }
+
+    /**
+     * Add an array of values
+     * The array is processed in tiles small enough to stay in the L1 cache:
+     * one loop computes the exact sum, minimum and maximum of a tile, a second loop over the cached tile
+     * computes its squared differences, and the tile is merged like a partial result.
+     * This avoids a division per value without reading the array from memory twice.
+     *
+     * @param numbers - The array of numbers
+     * @param size - The size of the array
+     */
+    void add(const T numbers[], std::size_t size) {
+        const std::size_t tileSize = 1024;
+        for (std::size_t begin = 0; begin < size; begin += tileSize) {
+            std::size_t end = begin + tileSize < size ? begin + tileSize : size;
+
+            BasicStatistics tile;
+            tile.count = static_cast<long long>(end - begin);
+            for (std::size_t i = begin; i < end; i++) {
+                tile.sum += numbers[i];
+                tile.min = numbers[i] < tile.min ? numbers[i] : tile.min;
+                tile.max = numbers[i] > tile.max ? numbers[i] : tile.max;
+            }
+            tile.mean = double(tile.sum) / double(tile.count);
+            for (std::size_t i = begin; i < end; i++) {
+                double delta = double(numbers[i]) - tile.mean;
+                tile.m2 += delta * delta;
+            }
+            merge(tile);
+        }
+    }
+
+    /**
+     * Merge the statistics of another part of the input into this one
+     * @param other - The statistics to merge
+     */
+    void merge(const BasicStatistics &other) {
+        if (other.count == 0) {
+            return;
+        }
+        if (count == 0) {
+            *this = other;
+            return;
+        }
+        double total = double(count + other.count);
+        double delta = other.mean - mean;
+        mean += delta * double(other.count) / total;
+        m2 += other.m2 + delta * delta * double(count) * double(other.count) / total;
+
+        count += other.count;
+        sum += other.sum;
+        if (other.min < min) {
+            min = other.min;
+        }
+        if (other.max > max) {
+            max = other.max;
+        }
+    }
+
+    /**
+     * @return - The exact average, computed from the 64-bit sum
+     */
+    double average() const {
+        return double(sum) / double(count);
+    }
+
+    /**
+     * @return - The population variance
+     */
+    double variance() const {
+        return m2 / double(count);
+    }
+
+    /**
+     * @return - The population standard deviation
+     */
+    double standardDeviation() const {
+        return std::sqrt(variance());
+    }
+};
+
+using Statistics = BasicStatistics<int>;
+using Statistics64 = BasicStatistics<long long>;
+
+/**
+ * Calculate the statistics of an array with the tasks of a thread pool
+ * The array is cut into chunks, each task reduces one chunk and the partial results are merged in order.
+ *
+ * @param pool - The thread pool
+ * @param numbers - The array of numbers
+ * @param size - The size of the array
+ * @return - The statistics of the array
+ */
+template<typename T>
+BasicStatistics<T> parallelStatistics(ThreadPool &pool, const T numbers[], std::size_t size) {
+    // Enough chunks to balance the workers, but not so small that scheduling costs more than reducing
+    std::size_t grain = std::max<std::size_t>(size / (4 * pool.size()) + 1, 16384);
+    return pool.parallelReduce(std::size_t(0), size, grain, BasicStatistics<T>(),
+                               [numbers](std::size_t begin, std::size_t end) {
+                                   BasicStatistics<T> chunk;
+                                   chunk.add(numbers + begin, end - begin);
+                                   return chunk;
+                               },
+                               [](BasicStatistics<T> &result, const BasicStatistics<T> &chunk) {
+                                   result.merge(chunk);
+                               });
+}
+
+#endif // MULTIPLETHREAD_STATISTICS_H
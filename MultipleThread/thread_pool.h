@@ -0,0 +1,289 @@
+#ifndef MULTIPLETHREAD_THREAD_POOL_H
+#define MULTIPLETHREAD_THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Work-stealing thread pool
+ *
+ * Creating a thread costs tens of microseconds, which is more than reducing a small array takes.
+ * The pool creates its worker threads once and keeps them for every later task.
+ *
+ * - Every worker owns a deque of tasks. A worker pushes and pops the tasks it creates at the back (LIFO),
+ *   so nested work runs while its data is still in the cache.
+ * - A worker whose deque is empty steals from the front of another worker's deque (FIFO),
+ *   which takes the oldest and usually largest piece of work.
+ * - Tasks submitted from outside the pool are spread over the deques round-robin.
+ * - Idle workers sleep on a condition variable instead of spinning.
+ *
+ * A thread that waits for tasks (parallelFor, wait) runs pending tasks in the meantime,
+ * so a task can itself call parallelFor without blocking a worker, and nested loops never deadlock.
+ */
+class ThreadPool {
+    struct alignas(64) Queue {
+        std::deque<std::function<void()>> tasks;
+        std::mutex mtx;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<long> pending{0};      // Tasks pushed but not yet taken
+    std::atomic<unsigned> nextQueue{0};
+    std::mutex sleepMutex;
+    std::condition_variable sleepCv;
+    bool stopping = false;
+
+    // The pool and deque of the current thread, if it is a worker
+    static inline thread_local ThreadPool *currentPool = nullptr;
+    static inline thread_local unsigned currentIndex = 0;
+
+    /**
+     * Add a task to the deque of the current worker, or to the next deque for an outside thread
+     * @param task - The task
+     */
+    void push(std::function<void()> task) {
+        unsigned index = currentPool == this ? currentIndex : nextQueue++ % queues.size();
+        pending++;
+        {
+            std::lock_guard<std::mutex> lock(queues[index]->mtx);
+            queues[index]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+        }
+        sleepCv.notify_one();
+    }
+
+    /**
+     * Take a task, first from the back of the own deque, then from the front of the other deques
+     * @param index - The deque to start with
+     * @param task - Receives the task
+     * @return - True if a task was taken
+     */
+    bool pop(unsigned index, std::function<void()> &task) {
+        {
+            std::lock_guard<std::mutex> lock(queues[index]->mtx);
+            if (!queues[index]->tasks.empty()) {
+                task = std::move(queues[index]->tasks.back());
+                queues[index]->tasks.pop_back();
+                pending--;
+                return true;
+            }
+        }
+        for (std::size_t i = 1; i < queues.size(); i++) {
+            Queue &victim = *queues[(index + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mtx);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                pending--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * The loop of a worker thread
+     * @param index - The deque of the worker
+     */
+    void work(unsigned index) {
+        currentPool = this;
+        currentIndex = index;
+        std::function<void()> task;
+        while (true) {
+            if (pop(index, task)) {
+                task();
+                task = nullptr;
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepCv.wait(lock, [this] { return stopping || pending.load() > 0; });
+            if (stopping && pending.load() <= 0) {
+                return;
+            }
+        }
+    }
+
+public:
+    /**
+     * Create the worker threads
+     * @param threads - The number of workers, by default one per hardware thread
+     */
+    explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency()) {
+        if (threads == 0) {
+            threads = 1;
+        }
+        for (unsigned i = 0; i < threads; i++) {
+            queues.emplace_back(new Queue);
+        }
+        workers.reserve(threads);
+        for (unsigned i = 0; i < threads; i++) {
+            workers.emplace_back(&ThreadPool::work, this, i);
+        }
+    }
+
+    /**
+     * Run the remaining tasks and join the worker threads
+     */
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        sleepCv.notify_all();
+        for (auto &worker: workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /**
+     * @return - The number of worker threads
+     */
+    unsigned size() const {
+        return static_cast<unsigned>(workers.size());
+    }
+
+    /**
+     * Submit a task
+     * @param f - The function to run
+     * @param args - The arguments of the function
+     * @return - The future result of the function
+     */
+    template<typename F, typename... Args>
+    auto submit(F &&f, Args &&... args) -> std::future<std::invoke_result_t<F, Args...>> {
+        using Result = std::invoke_result_t<F, Args...>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(
+                std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+        std::future<Result> future = task->get_future();
+        push([task] { (*task)(); });
+        return future;
+    }
+
+    /**
+     * Run one pending task on the calling thread
+     * @return - False if there was no task to run
+     */
+    bool runPendingTask() {
+        std::function<void()> task;
+        if (!pop(currentPool == this ? currentIndex : 0, task)) {
+            return false;
+        }
+        task();
+        return true;
+    }
+
+    /**
+     * Wait for a future, running pending tasks instead of blocking
+     * @param future - The future to wait for
+     * @return - The result of the future
+     */
+    template<typename T>
+    T wait(std::future<T> &future) {
+        while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            if (!runPendingTask()) {
+                std::this_thread::yield();
+            }
+        }
+        return future.get();
+    }
+
+    /**
+     * Run a loop body over a range in parallel
+     * The range is cut into chunks of `grain` indices. The calling thread runs the first chunk
+     * and then helps with the pending tasks until every chunk is done, so parallelFor can be nested.
+     *
+     * @param begin - The first index
+     * @param end - One past the last index
+     * @param grain - The number of indices per task
+     * @param body - Called as body(chunkBegin, chunkEnd)
+     */
+    template<typename Body>
+    void parallelFor(std::size_t begin, std::size_t end, std::size_t grain, Body body) {
+        if (end <= begin) {
+            return;
+        }
+        grain = std::max<std::size_t>(grain, 1);
+        std::size_t chunks = (end - begin + grain - 1) / grain;
+        std::atomic<std::size_t> remaining(chunks);
+        std::exception_ptr error;
+        std::mutex errorMutex;
+
+        auto runChunk = [&](std::size_t chunk) {
+            try {
+                std::size_t chunkBegin = begin + chunk * grain;
+                body(chunkBegin, std::min(end, chunkBegin + grain));
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+            remaining--;
+        };
+        for (std::size_t chunk = 1; chunk < chunks; chunk++) {
+            push([&runChunk, chunk] { runChunk(chunk); });
+        }
+        runChunk(0);
+
+        while (remaining.load() > 0) {
+            if (!runPendingTask()) {
+                std::this_thread::yield();
+            }
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    /**
+     * Reduce a range in parallel
+     * @param begin - The first index
+     * @param end - One past the last index
+     * @param grain - The number of indices per task
+     * @param identity - The result of an empty range
+     * @param map - Called as map(chunkBegin, chunkEnd), returns the partial result of a chunk
+     * @param merge - Called as merge(result, partial) in chunk order
+     * @return - The merged result
+     */
+    template<typename T, typename Map, typename Merge>
+    T parallelReduce(std::size_t begin, std::size_t end, std::size_t grain, T identity, Map map, Merge merge) {
+        if (end <= begin) {
+            return identity;
+        }
+        grain = std::max<std::size_t>(grain, 1);
+        std::size_t chunks = (end - begin + grain - 1) / grain;
+        std::vector<T> partial(chunks, identity);
+        parallelFor(0, chunks, 1, [&](std::size_t first, std::size_t last) {
+            for (std::size_t chunk = first; chunk < last; chunk++) {
+                std::size_t chunkBegin = begin + chunk * grain;
+                partial[chunk] = map(chunkBegin, std::min(end, chunkBegin + grain));
+            }
+        });
+
+        T result = identity;
+        for (const T &value: partial) {
+            merge(result, value);
+        }
+        return result;
+    }
+};
+
+#endif // MULTIPLETHREAD_THREAD_POOL_H
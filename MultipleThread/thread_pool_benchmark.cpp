@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "statistics.h"
+#include "thread_pool.h"
+
+/**
+ * Thread pool benchmark
+ *
+ * Computes the statistics of arrays of growing size, repeatedly, and reports the time of one computation:
+ * - fresh threads: three new std::threads (average, minimum, maximum) per computation, the way main() used to
+ * - fresh chunks: one new std::thread per hardware thread, each reducing a chunk
+ * - pool tasks: the same three calculations submitted to a thread pool created once
+ * - pool chunks: parallelStatistics on the same thread pool
+ * - pool nested: a parallelFor over four parts whose tasks call parallelStatistics again
+ *
+ * At small sizes the fresh threads spend nearly all their time being created and joined.
+ *
+ * Usage:
+ * ```bash
+ * ./MultipleThreadPoolBenchmark [threads]
+ * ```
+ */
+
+/**
+ * Measure the average time of a computation
+ * @param repetitions - How often to repeat the computation
+ * @param compute - The computation, returns the sum it found
+ * @param expected - The correct sum
+ * @return - The microseconds per computation, or -1 if the result was wrong
+ */
+template<typename Compute>
+double measure(int repetitions, Compute compute, long long expected) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repetitions; i++) {
+        if (compute() != expected) {
+            return -1;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / repetitions;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned threads = argc > 1 ? static_cast<unsigned>(std::stoul(argv[1])) : std::thread::hardware_concurrency();
+    if (threads == 0) {
+        threads = 1;
+    }
+    ThreadPool pool(threads);
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> distribution(-1000000, 1000000);
+
+    std::cout << "Microseconds per computation with " << threads << " thread(s)" << std::endl;
+    std::cout << std::setw(10) << "size" << std::setw(16) << "fresh threads" << std::setw(16) << "fresh chunks"
+              << std::setw(16) << "pool tasks" << std::setw(16) << "pool chunks" << std::setw(16) << "pool nested"
+              << std::endl;
+
+    for (std::size_t size = 16; size <= (1 << 22); size *= 16) {
+        std::vector<int> numbers(size);
+        long long expected = 0;
+        for (auto &number: numbers) {
+            number = distribution(gen);
+            expected += number;
+        }
+        const int *data = numbers.data();
+        int repetitions = static_cast<int>(std::max<std::size_t>(20, (std::size_t(1) << 16) / size));
+
+        double freshThreads = measure(repetitions, [&] {
+            long long sum = 0;
+            int min = 0;
+            int max = 0;
+            std::thread t1([&] {
+                for (std::size_t i = 0; i < size; i++) {
+                    sum += data[i];
+                }
+            });
+            std::thread t2([&] {
+                min = data[0];
+                for (std::size_t i = 1; i < size; i++) {
+                    min = data[i] < min ? data[i] : min;
+                }
+            });
+            std::thread t3([&] {
+                max = data[0];
+                for (std::size_t i = 1; i < size; i++) {
+                    max = data[i] > max ? data[i] : max;
+                }
+            });
+            t1.join();
+            t2.join();
+            t3.join();
+            return sum;
+        }, expected);
+
+        double freshChunks = measure(repetitions, [&] {
+            std::vector<Statistics> partial(threads);
+            std::vector<std::thread> workers;
+            workers.reserve(threads);
+            for (unsigned t = 0; t < threads; t++) {
+                workers.emplace_back([&, t] {
+                    std::size_t begin = size * t / threads;
+                    std::size_t end = size * (t + 1) / threads;
+                    partial[t].add(data + begin, end - begin);
+                });
+            }
+            Statistics result;
+            for (unsigned t = 0; t < threads; t++) {
+                workers[t].join();
+                result.merge(partial[t]);
+            }
+            return result.sum;
+        }, expected);
+
+        double poolTasks = measure(repetitions, [&] {
+            auto sum = pool.submit([&] {
+                long long total = 0;
+                for (std::size_t i = 0; i < size; i++) {
+                    total += data[i];
+                }
+                return total;
+            });
+            auto min = pool.submit([&] {
+                int value = data[0];
+                for (std::size_t i = 1; i < size; i++) {
+                    value = data[i] < value ? data[i] : value;
+                }
+                return value;
+            });
+            auto max = pool.submit([&] {
+                int value = data[0];
+                for (std::size_t i = 1; i < size; i++) {
+                    value = data[i] > value ? data[i] : value;
+                }
+                return value;
+            });
+            min.get();
+            max.get();
+            return sum.get();
+        }, expected);
+
+        double poolChunks = measure(repetitions, [&] {
+            return parallelStatistics(pool, data, size).sum;
+        }, expected);
+
+        double poolNested = measure(repetitions, [&] {
+            std::vector<Statistics> parts(4);
+            pool.parallelFor(0, 4, 1, [&](std::size_t first, std::size_t last) {
+                for (std::size_t part = first; part < last; part++) {
+                    std::size_t begin = size * part / 4;
+                    std::size_t end = size * (part + 1) / 4;
+                    parts[part] = parallelStatistics(pool, data + begin, end - begin);
+                }
+            });
+            Statistics result;
+            for (const auto &part: parts) {
+                result.merge(part);
+            }
+            return result.sum;
+        }, expected);
+
+        std::cout << std::setw(10) << size << std::fixed << std::setprecision(2)
+                  << std::setw(16) << freshThreads << std::setw(16) << freshChunks << std::setw(16) << poolTasks
+                  << std::setw(16) << poolChunks << std::setw(16) << poolNested << std::endl;
+    }
+
+    return 0;
+}
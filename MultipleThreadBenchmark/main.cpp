@@ -0,0 +1,447 @@
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "parser.h"
+#include "statistics.h"
+#include "thread_pool.h"
+#include "pthread_statistics.h"
+
+/**
+ * Benchmark suite for the statistics backends of the MultipleThread programs
+ *
+ * Every backend calculates the sum, minimum, maximum and variance of the same arrays,
+ * over a range of input sizes, thread counts and data distributions:
+ * - single: Statistics::add on the calling thread, the baseline of the speedup
+ * - std::thread tasks / pthread tasks: a fresh thread per statistic (average, minimum, maximum) per run,
+ *   the way MultipleThread and MultipleThreadLinux calculate, plus a fourth one for the variance
+ *   so that they do the same work as the other backends
+ * - std::thread chunks / pthread chunks: one fresh thread per chunk of the array
+ * - pool chunks: parallelStatistics on a work-stealing thread pool created before the measurement
+ * - text single / text pool: parse the same values from their text format, with parseText on the calling thread
+ *   or with parallelParse on the thread pool, as MultipleThread loads its input
+ *
+ * Every row reports the median wall time of the repetitions, the cycles per element
+ * (time-stamp counter cycles, empty where the counter is not available) and the speedup over the single-threaded baseline,
+ * "single" for the statistics and "text single" for the parsing.
+ *
+ * Usage:
+ * ```bash
+ * ./MultipleThreadBenchmark [--format csv|json] [--sizes 1000,1000000] [--threads 1,2,4]
+ *                           [--distributions uniform,sorted,reversed,normal] [--repetitions N]
+ * ```
+ */
+
+/**
+ * Read the cycle counter
+ * @return - The time-stamp counter, or 0 if there is none
+ */
+inline unsigned long long readCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * A way of calculating the statistics
+ */
+struct Backend {
+    std::string name;
+    bool parallel;  // False if the backend ignores the thread count
+    std::function<long long(const int *, std::size_t, unsigned)> run;  // Returns the sum, to check the result
+    bool text = false;  // True if the backend parses the text of the numbers instead of reading the array
+};
+
+/**
+ * The arguments of the pthread task functions, like the ThreadData of MultipleThreadLinux
+ */
+struct TaskData {
+    const int *numbers;
+    std::size_t size;
+    long long sum;
+    int min;
+    int max;
+    double variance;
+};
+
+void *sumTask(void *param) {
+    auto *data = static_cast<TaskData *>(param);
+    long long sum = 0;
+    for (std::size_t i = 0; i < data->size; i++) {
+        sum += data->numbers[i];
+    }
+    data->sum = sum;
+    return nullptr;
+}
+
+void *minTask(void *param) {
+    auto *data = static_cast<TaskData *>(param);
+    int min = data->numbers[0];
+    for (std::size_t i = 1; i < data->size; i++) {
+        min = data->numbers[i] < min ? data->numbers[i] : min;
+    }
+    data->min = min;
+    return nullptr;
+}
+
+void *maxTask(void *param) {
+    auto *data = static_cast<TaskData *>(param);
+    int max = data->numbers[0];
+    for (std::size_t i = 1; i < data->size; i++) {
+        max = data->numbers[i] > max ? data->numbers[i] : max;
+    }
+    data->max = max;
+    return nullptr;
+}
+
+void *varianceTask(void *param) {
+    auto *data = static_cast<TaskData *>(param);
+    long long sum = 0;
+    for (std::size_t i = 0; i < data->size; i++) {
+        sum += data->numbers[i];
+    }
+    double mean = double(sum) / double(data->size);
+    double m2 = 0;
+    for (std::size_t i = 0; i < data->size; i++) {
+        double delta = double(data->numbers[i]) - mean;
+        m2 += delta * delta;
+    }
+    data->variance = m2 / double(data->size);
+    return nullptr;
+}
+
+/**
+ * Split a comma-separated list
+ * @param text - The list
+ * @return - The items
+ */
+std::vector<std::string> splitList(const std::string &text) {
+    std::vector<std::string> items;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+/**
+ * Parse a size, thread count or repetition count
+ * @param text - The number
+ * @return - The number, at least 1
+ */
+unsigned parsePositive(const std::string &text) {
+    int value = parseNumber(text.c_str());
+    if (value <= 0) {
+        throw std::invalid_argument("The sizes, thread counts and repetitions must be positive.");
+    }
+    return static_cast<unsigned>(value);
+}
+
+/**
+ * Generate the input of a benchmark
+ * @param distribution - uniform, sorted, reversed or normal
+ * @param size - The number of values
+ * @return - The values
+ */
+std::vector<int> generate(const std::string &distribution, std::size_t size) {
+    std::mt19937 gen(42);
+    std::vector<int> numbers(size);
+    if (distribution == "normal") {
+        std::normal_distribution<double> normal(0, 1000000);
+        for (auto &number: numbers) {
+            number = static_cast<int>(normal(gen));
+        }
+        return numbers;
+    }
+
+    std::uniform_int_distribution<int> uniform(INT_MIN, INT_MAX);
+    for (auto &number: numbers) {
+        number = uniform(gen);
+    }
+    if (distribution == "sorted") {
+        std::sort(numbers.begin(), numbers.end());
+    } else if (distribution == "reversed") {
+        std::sort(numbers.begin(), numbers.end(), std::greater<int>());
+    } else if (distribution != "uniform") {
+        std::cerr << "Unknown distribution " << distribution << std::endl;
+        std::exit(1);
+    }
+    return numbers;
+}
+
+/**
+ * Write the values in the text format, one per line
+ * @param numbers - The values
+ * @return - The text
+ */
+std::string toText(const std::vector<int> &numbers) {
+    std::string text(numbers.size() * 12, '\0');
+    char *p = &text[0];
+    for (int number: numbers) {
+        p = std::to_chars(p, p + 11, number).ptr;
+        *p++ = '\n';
+    }
+    text.resize(p - text.data());
+    return text;
+}
+
+/**
+ * The result of one backend on one input
+ */
+struct Measurement {
+    double nanoseconds;
+    double cyclesPerElement;
+};
+
+/**
+ * Run a backend repeatedly and take the median
+ * @param backend - The backend
+ * @param numbers - The input
+ * @param threads - The thread count
+ * @param repetitions - How often to run the backend
+ * @param expected - The correct sum
+ * @return - The median wall time and cycles per element
+ */
+Measurement measure(const Backend &backend, const std::vector<int> &numbers, unsigned threads, int repetitions,
+                    long long expected) {
+    std::vector<double> times;
+    std::vector<double> cycles;
+    for (int i = 0; i < repetitions; i++) {
+        auto start = std::chrono::steady_clock::now();
+        unsigned long long startCycles = readCycles();
+        long long sum = backend.run(numbers.data(), numbers.size(), threads);
+        unsigned long long endCycles = readCycles();
+        auto end = std::chrono::steady_clock::now();
+        if (sum != expected) {
+            std::cerr << backend.name << " calculated the wrong sum." << std::endl;
+            std::exit(1);
+        }
+        times.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+        cycles.push_back(double(endCycles - startCycles) / double(numbers.size()));
+    }
+    std::nth_element(times.begin(), times.begin() + repetitions / 2, times.end());
+    std::nth_element(cycles.begin(), cycles.begin() + repetitions / 2, cycles.end());
+    return {times[repetitions / 2], cycles[repetitions / 2]};
+}
+
+int main(int argc, char *argv[]) {
+    std::string format = "csv";
+    std::vector<std::size_t> sizes = {1000, 10000, 100000, 1000000, 10000000};
+    std::vector<unsigned> threadCounts;
+    std::vector<std::string> distributions = {"uniform", "sorted", "reversed", "normal"};
+    int repetitions = 0;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string option = argv[i];
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << option << std::endl;
+                return 1;
+            }
+            std::string value = argv[++i];
+            if (option == "--format") {
+                format = value;
+            } else if (option == "--sizes") {
+                sizes.clear();
+                for (const auto &item: splitList(value)) {
+                    sizes.push_back(parsePositive(item));
+                }
+            } else if (option == "--threads") {
+                for (const auto &item: splitList(value)) {
+                    threadCounts.push_back(parsePositive(item));
+                }
+            } else if (option == "--distributions") {
+                distributions = splitList(value);
+            } else if (option == "--repetitions") {
+                repetitions = static_cast<int>(parsePositive(value));
+            } else {
+                std::cerr << "Unknown option " << option << std::endl;
+                return 1;
+            }
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    if (format != "csv" && format != "json") {
+        std::cerr << "The format must be csv or json." << std::endl;
+        return 1;
+    }
+    if (threadCounts.empty()) {
+        unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned t = 1; t < hardware; t *= 2) {
+            threadCounts.push_back(t);
+        }
+        threadCounts.push_back(hardware);
+    }
+
+    // A thread that cannot be created stops the suite
+    try {
+        // The pools are created before the measurements, once per thread count
+        std::map<unsigned, std::unique_ptr<ThreadPool>> pools;
+        for (unsigned threads: threadCounts) {
+            pools[threads].reset(new ThreadPool(threads));
+        }
+
+        // The text of the current input, for the parsing backends
+        std::string text;
+
+        std::vector<Backend> backends = {
+                {"single", false, [](const int *numbers, std::size_t size, unsigned) {
+                    Statistics stats;
+                    stats.add(numbers, size);
+                    return stats.sum;
+                }},
+                {"std::thread tasks", false, [](const int *numbers, std::size_t size, unsigned) {
+                    TaskData data = {numbers, size, 0, 0, 0, 0};
+                    std::thread t1(sumTask, &data);
+                    std::thread t2(minTask, &data);
+                    std::thread t3(maxTask, &data);
+                    std::thread t4(varianceTask, &data);
+                    t1.join();
+                    t2.join();
+                    t3.join();
+                    t4.join();
+                    return data.sum;
+                }},
+                {"pthread tasks", false, [](const int *numbers, std::size_t size, unsigned) {
+                    TaskData data = {numbers, size, 0, 0, 0, 0};
+                    void *(*tasks[])(void *) = {sumTask, minTask, maxTask, varianceTask};
+                    pthread_t ids[4];
+                    int created = 0;
+                    for (auto task: tasks) {
+                        if (pthread_create(&ids[created], nullptr, task, &data) != 0) {
+                            break;
+                        }
+                        created++;
+                    }
+                    // Only join the threads that exist
+                    for (int i = 0; i < created; i++) {
+                        pthread_join(ids[i], nullptr);
+                    }
+                    if (created < 4) {
+                        throw std::runtime_error("Failed to create a thread.");
+                    }
+                    return data.sum;
+                }},
+                {"std::thread chunks", true, [](const int *numbers, std::size_t size, unsigned threads) {
+                    std::vector<Statistics> partial(threads);
+                    std::vector<std::thread> workers;
+                    workers.reserve(threads);
+                    for (unsigned t = 0; t < threads; t++) {
+                        workers.emplace_back([&, t] {
+                            std::size_t begin = size * t / threads;
+                            partial[t].add(numbers + begin, size * (t + 1) / threads - begin);
+                        });
+                    }
+                    Statistics stats;
+                    for (unsigned t = 0; t < threads; t++) {
+                        workers[t].join();
+                        stats.merge(partial[t]);
+                    }
+                    return stats.sum;
+                }},
+                {"pthread chunks", true, [](const int *numbers, std::size_t size, unsigned threads) {
+                    return pthreadStatistics(numbers, size, threads).sum;
+                }},
+                {"pool chunks", true, [&pools](const int *numbers, std::size_t size, unsigned threads) {
+                    return parallelStatistics(*pools[threads], numbers, size).sum;
+                }},
+                {"text single", false, [&text](const int *, std::size_t size, unsigned) {
+                    std::vector<int> values;
+                    values.reserve(size);
+                    parseText(text.data(), text.data() + text.size(),
+                              [&values](int value) { values.push_back(value); });
+                    return std::accumulate(values.begin(), values.end(), 0LL);
+                }, true},
+                {"text pool", true, [&pools, &text](const int *, std::size_t, unsigned threads) {
+                    std::vector<int> values = parallelParse(*pools[threads], text.data(), text.size());
+                    return std::accumulate(values.begin(), values.end(), 0LL);
+                }, true},
+        };
+        // The first backend is the baseline of the statistics, the first text backend the one of the parsing
+        const Backend &textSingle = *std::find_if(backends.begin(), backends.end(),
+                                                   [](const Backend &backend) { return backend.text; });
+
+        bool first = true;
+        if (format == "csv") {
+            std::cout << "backend,distribution,size,threads,repetitions,wall_ns,cycles_per_element,speedup"
+                      << std::endl;
+        } else {
+            std::cout << "[" << std::endl;
+        }
+
+        for (const auto &distribution: distributions) {
+            for (std::size_t size: sizes) {
+                std::vector<int> numbers = generate(distribution, size);
+                long long expected = 0;
+                for (int number: numbers) {
+                    expected += number;
+                }
+                int runs = repetitions > 0 ? repetitions : int(std::min<std::size_t>(
+                        1000, std::max<std::size_t>(5, (std::size_t(1) << 24) / std::max<std::size_t>(size, 1))));
+                text = toText(numbers);
+                double arrayBaseline = measure(backends[0], numbers, 1, runs, expected).nanoseconds;
+                double textBaseline = measure(textSingle, numbers, 1, runs, expected).nanoseconds;
+
+                for (const auto &backend: backends) {
+                    std::vector<unsigned> counts = backend.parallel ? threadCounts : std::vector<unsigned>{
+                            backend.name.find("tasks") != std::string::npos ? 4u : 1u};
+                    double baseline = backend.text ? textBaseline : arrayBaseline;
+                    for (unsigned threads: counts) {
+                        Measurement m = measure(backend, numbers, threads, runs, expected);
+                        std::ostringstream cycles;
+                        if (readCycles() != 0) {
+                            cycles << m.cyclesPerElement;
+                        }
+
+                        if (format == "csv") {
+                            std::cout << backend.name << "," << distribution << "," << size << "," << threads << ","
+                                      << runs << "," << m.nanoseconds << "," << cycles.str() << ","
+                                      << baseline / m.nanoseconds << std::endl;
+                        } else {
+                            std::cout << (first ? "" : ",\n") << "  {\"backend\": \"" << backend.name
+                                      << "\", \"distribution\": \"" << distribution << "\", \"size\": " << size
+                                      << ", \"threads\": " << threads << ", \"repetitions\": " << runs
+                                      << ", \"wall_ns\": " << m.nanoseconds << ", \"cycles_per_element\": "
+                                      << (cycles.str().empty() ? "null" : cycles.str())
+                                      << ", \"speedup\": " << baseline / m.nanoseconds << "}";
+                        }
+                        first = false;
+                    }
+                }
+            }
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    if (format == "json") {
+        std::cout << "\n]" << std::endl;
+    }
+    return 0;
+}
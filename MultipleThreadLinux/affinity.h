@@ -0,0 +1,231 @@
+#ifndef MULTIPLETHREADLINUX_AFFINITY_H
+#define MULTIPLETHREADLINUX_AFFINITY_H
+
+#include <pthread.h>
+#include <sched.h>
+#include <dirent.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * Thread placement
+ *
+ * By default the scheduler may run a thread on any CPU and move it later, and the memory of an array
+ * is placed on the NUMA node of the thread that first writes each page. On a host with several sockets,
+ * a chunk reduced by a thread on the other socket is read across the interconnect at a fraction of the bandwidth.
+ *
+ * A placement policy chooses a CPU for every thread, which is applied with pthread_attr_setaffinity_np
+ * before the thread is created:
+ * - compact: fill the CPUs of the first node before the next one, the threads share caches
+ * - scatter: take the CPUs from the nodes in turn, the threads use the memory controllers of every node
+ * - list:0,2,4-7: an explicit list of CPUs, repeated if there are more threads than CPUs
+ *
+ * The nodes are read from /sys/devices/system/node. Only the CPUs the process is allowed to run on are used.
+ */
+
+enum class AffinityPolicy {
+    None,
+    Compact,
+    Scatter,
+    List
+};
+
+/**
+ * Parse one CPU number of a CPU list
+ * @param begin - The first character of the number
+ * @param stop - One past its last character, a dash, comma or the end of the list
+ * @param text - The whole list, for the error message
+ * @return - The CPU
+ */
+inline int parseCpu(const char *begin, const char *stop, const std::string &text) {
+    // strtol would also skip spaces and accept a sign
+    if (begin == stop || *begin < '0' || *begin > '9') {
+        throw std::invalid_argument("Invalid CPU list: " + text);
+    }
+    char *end = nullptr;
+    long cpu = std::strtol(begin, &end, 10);
+    if (end != stop) {
+        throw std::invalid_argument("Invalid CPU list: " + text);
+    }
+    if (cpu >= CPU_SETSIZE) {
+        throw std::out_of_range("CPU " + std::string(begin, stop) + " is beyond the largest CPU set of "
+                                + std::to_string(CPU_SETSIZE) + " CPUs");
+    }
+    return static_cast<int>(cpu);
+}
+
+/**
+ * Parse a CPU list in the kernel format, e.g. "0-3,8,10-11"
+ * @param text - The list
+ * @return - The CPUs
+ */
+inline std::vector<int> parseCpuList(const std::string &text) {
+    std::vector<int> cpus;
+    std::size_t pos = 0;
+    while (pos < text.size()) {
+        std::size_t comma = text.find(',', pos);
+        std::string item = text.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        pos = comma == std::string::npos ? text.size() : comma + 1;
+        if (!item.empty() && item.back() == '\n') {
+            item.pop_back();
+        }
+        if (item.empty()) {
+            continue;
+        }
+        // Each number must end exactly at the dash or at the end of the item
+        const char *begin = item.c_str();
+        const char *end = begin + item.size();
+        std::size_t dash = item.find('-');
+        int first = parseCpu(begin, dash == std::string::npos ? end : begin + dash, text);
+        int last = dash == std::string::npos ? first : parseCpu(begin + dash + 1, end, text);
+        if (last < first) {
+            throw std::invalid_argument("Invalid CPU list: " + text);
+        }
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+/**
+ * Read the CPUs of every NUMA node the process may run on
+ * @return - One list of CPUs per node, a single node if the machine does not report any
+ */
+inline std::vector<std::vector<int>> readNodes() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+
+    std::vector<int> nodeIds;
+    if (DIR *dir = opendir("/sys/devices/system/node")) {
+        while (dirent *entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name.compare(0, 4, "node") == 0 && name.size() > 4 &&
+                name.find_first_not_of("0123456789", 4) == std::string::npos) {
+                nodeIds.push_back(std::atoi(name.c_str() + 4));
+            }
+        }
+        closedir(dir);
+    }
+    std::sort(nodeIds.begin(), nodeIds.end());
+
+    std::vector<std::vector<int>> nodes;
+    for (int id: nodeIds) {
+        std::ifstream file("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+        std::string text;
+        std::getline(file, text);
+        std::vector<int> cpus;
+        for (int cpu: parseCpuList(text)) {
+            if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) {
+                cpus.push_back(cpu);
+            }
+        }
+        if (!cpus.empty()) {
+            nodes.push_back(cpus);
+        }
+    }
+
+    if (nodes.empty()) {
+        std::vector<int> cpus;
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &allowed)) {
+                cpus.push_back(cpu);
+            }
+        }
+        nodes.push_back(cpus);
+    }
+    return nodes;
+}
+
+/**
+ * Parse a policy option: none, compact, scatter or list:<cpus>
+ * @param text - The option
+ * @param cpus - Set to the CPUs of a list policy
+ * @return - The policy
+ */
+inline AffinityPolicy parsePolicy(const std::string &text, std::vector<int> &cpus) {
+    if (text == "none") {
+        return AffinityPolicy::None;
+    }
+    if (text == "compact") {
+        return AffinityPolicy::Compact;
+    }
+    if (text == "scatter") {
+        return AffinityPolicy::Scatter;
+    }
+    if (text.compare(0, 5, "list:") == 0) {
+        cpus = parseCpuList(text.substr(5));
+        if (cpus.empty()) {
+            throw std::invalid_argument("The CPU list is empty.");
+        }
+        return AffinityPolicy::List;
+    }
+    throw std::invalid_argument("Unknown affinity policy: " + text);
+}
+
+/**
+ * Choose a CPU for every thread
+ * @param policy - The placement policy
+ * @param threads - The number of threads
+ * @param list - The CPUs of a list policy
+ * @return - The CPU of each thread, empty for no placement
+ */
+inline std::vector<int> placeThreads(AffinityPolicy policy, unsigned threads, const std::vector<int> &list = {}) {
+    std::vector<int> order;
+    if (policy == AffinityPolicy::None) {
+        return order;
+    }
+    if (policy == AffinityPolicy::List) {
+        order = list;
+    } else {
+        std::vector<std::vector<int>> nodes = readNodes();
+        if (policy == AffinityPolicy::Compact) {
+            for (const auto &node: nodes) {
+                order.insert(order.end(), node.begin(), node.end());
+            }
+        } else {
+            for (std::size_t i = 0;; i++) {
+                bool any = false;
+                for (const auto &node: nodes) {
+                    if (i < node.size()) {
+                        order.push_back(node[i]);
+                        any = true;
+                    }
+                }
+                if (!any) {
+                    break;
+                }
+            }
+        }
+    }
+
+    if (order.empty()) {
+        return order;
+    }
+    std::vector<int> placement(threads);
+    for (unsigned t = 0; t < threads; t++) {
+        placement[t] = order[t % order.size()];
+    }
+    return placement;
+}
+
+/**
+ * Pin the thread created with these attributes to a CPU
+ * @param attr - The attributes, already initialized
+ * @param cpu - The CPU
+ */
+inline void setThreadCpu(pthread_attr_t &attr, int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_attr_setaffinity_np(&attr, sizeof(set), &set) != 0) {
+        throw std::runtime_error("Failed to pin a thread to CPU " + std::to_string(cpu));
+    }
+}
+
+#endif // MULTIPLETHREADLINUX_AFFINITY_H
@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "affinity.h"
+#include "pthread_statistics.h"
+
+/**
+ * Placement benchmark
+ *
+ * Reduces an array much larger than the caches with one pinned pthread per chunk and reports the read bandwidth
+ * for every placement policy (none, compact, scatter), with the array written either
+ * - first-touch: by the thread that reduces each chunk, so the chunk is on that thread's NUMA node
+ * - main thread: by the parent thread alone, so the whole array is on the parent's node
+ *
+ * On a machine with a single node the two placements read the same memory,
+ * and compact and scatter only differ in how the threads share the caches.
+ *
+ * Usage:
+ * ```bash
+ * ./MultipleThreadLinuxAffinityBenchmark [megabytes] [threads]
+ * ```
+ */
+
+/**
+ * Measure the median bandwidth of the reduction
+ * @param numbers - The array
+ * @param size - The size of the array
+ * @param threads - The number of threads
+ * @param cpus - The placement of the threads
+ * @param expected - The correct sum
+ * @return - The read bandwidth in GB/s, or -1 if the result was wrong
+ */
+double measure(const int *numbers, std::size_t size, unsigned threads, const std::vector<int> &cpus,
+               long long expected) {
+    const int repetitions = 7;
+    std::vector<double> seconds;
+    for (int i = 0; i < repetitions; i++) {
+        auto start = std::chrono::steady_clock::now();
+        ChunkData total = pthreadStatistics(numbers, size, threads, cpus);
+        auto end = std::chrono::steady_clock::now();
+        if (total.sum != expected) {
+            return -1;
+        }
+        seconds.push_back(std::chrono::duration<double>(end - start).count());
+    }
+    std::nth_element(seconds.begin(), seconds.begin() + repetitions / 2, seconds.end());
+    return double(size * sizeof(int)) / seconds[repetitions / 2] / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 512;
+    unsigned threads = argc > 2 ? static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10))
+                                : std::thread::hardware_concurrency();
+    if (threads == 0) {
+        threads = 1;
+    }
+    std::size_t size = megabytes * (1 << 20) / sizeof(int);
+
+    std::vector<std::vector<int>> nodes = readNodes();
+    std::cout << "Read bandwidth in GB/s, " << megabytes << " MB, " << threads << " thread(s), "
+              << nodes.size() << " NUMA node(s)" << std::endl;
+    std::cout << std::setw(10) << "policy" << std::setw(14) << "first-touch" << std::setw(14) << "main thread"
+              << std::endl;
+
+    const char *policies[] = {"none", "compact", "scatter"};
+    for (const char *name: policies) {
+        std::vector<int> list;
+        std::vector<int> cpus = placeThreads(parsePolicy(name, list), threads, list);
+
+        // First-touch: the same placement fills and then reads every chunk
+        int *placed = new int[size];
+        long long expected = firstTouchStatistics(placed, size, threads, cpus, generateNumbers, nullptr).sum;
+        double firstTouch = measure(placed, size, threads, cpus, expected);
+        delete[] placed;
+
+        int *central = new int[size];
+        generateNumbers(central, 0, size, nullptr);
+        double mainThread = measure(central, size, threads, cpus, expected);
+        delete[] central;
+
+        std::cout << std::setw(10) << name << std::fixed << std::setprecision(2) << std::setw(14) << firstTouch
+                  << std::setw(14) << mainThread << std::endl;
+    }
+    return 0;
+}
@@ -1,6 +1,15 @@
 #include <iostream>
+#include <iomanip>
 #include <pthread.h>
 #include <cstdlib>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include "affinity.h"
+#include "pthread_statistics.h"
 
 /**
  * Write a multi-threaded program that calculates various statistical values for a list of numbers.
@@ -15,9 +24,23 @@
  * - The maximum value is 95.
  * The variables representing the average, minimum, and maximum values will be stored globally.
  * The worker threads will set these values, and the parent thread will output the values once the workers have exited.
+ *
+ * The average thread also reports the variance and the standard deviation.
+ * They are computed in the same pass with Welford's algorithm, and the sum is kept in 64 bits so it cannot overflow.
+ *
+ * With options, the array is split into one chunk per thread instead (see pthread_statistics.h),
+ * and the threads can be pinned to CPUs (see affinity.h):
+ * ```bash
+ * ./MultipleThreadLinux [--threads N] [--affinity none|compact|scatter|list:0,2,4-7] 90 81 78 95 79 72 85
+ * ./MultipleThreadLinux [--threads N] [--affinity POLICY] --generate COUNT
+ * ```
+ * Every thread writes its own chunk before reducing it, so the memory of a chunk is placed on the NUMA node
+ * of the CPU that reads it. --generate fills the chunks with pseudo-random values instead of the arguments.
  */
 
-int average = 0;
+double average = 0;
+double variance = 0;
+double standardDeviation = 0;
 int min = 0;
 int max = 0;
 
@@ -28,11 +51,18 @@ struct ThreadData {
 
 void* calculateAverage(void* param) {
     auto* data = static_cast<ThreadData*>(param);
-    int sum = 0;
+    long long sum = 0;
+    double mean = 0;
+    double m2 = 0;
     for (int i = 0; i < data->size; i++) {
         sum += data->numbers[i];
+        double delta = data->numbers[i] - mean;
+        mean += delta / (i + 1);
+        m2 += delta * (data->numbers[i] - mean);
     }
-    average = sum / data->size;
+    average = double(sum) / data->size;
+    variance = m2 / data->size;
+    standardDeviation = std::sqrt(variance);
     pthread_exit(nullptr);
     return nullptr;
 }
@@ -61,12 +91,114 @@ void* calculateMax(void* param) {
     return nullptr;
 }
 
+/**
+ * Fill a chunk with the numbers of the command line
+ * @param chunk - The chunk
+ * @param first - The index of its first value
+ * @param count - The number of values
+ * @param context - The parsed arguments
+ */
+void copyNumbers(int *chunk, std::size_t first, std::size_t count, const void *context) {
+    std::memcpy(chunk, static_cast<const int *>(context) + first, count * sizeof(int));
+}
+
+/**
+ * Calculate the statistics with one pinned pthread per chunk
+ * @param argc - The number of arguments
+ * @param argv - The arguments array, starting with an option
+ * @return - The exit code
+ */
+int runChunks(int argc, char *argv[]) {
+    unsigned threads = 4;
+    std::string affinity = "none";
+    std::size_t generate = 0;
+    int i = 1;
+    for (; i < argc && std::strncmp(argv[i], "--", 2) == 0; i++) {
+        std::string option = argv[i];
+        if (i + 1 >= argc) {
+            std::cout << "Missing value for " << option << std::endl;
+            return 1;
+        }
+        if (option == "--threads") {
+            threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (option == "--affinity") {
+            affinity = argv[++i];
+        } else if (option == "--generate") {
+            generate = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            std::cout << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+    if (threads == 0) {
+        std::cout << "The number of threads must be positive." << std::endl;
+        return 1;
+    }
+
+    std::vector<int> arguments;
+    for (; i < argc; i++) {
+        arguments.push_back(static_cast<int>(std::strtol(argv[i], nullptr, 10)));
+    }
+    if ((generate > 0) == !arguments.empty()) {
+        std::cout << "Please provide either numbers or --generate COUNT." << std::endl;
+        return 1;
+    }
+    std::size_t size = generate > 0 ? generate : arguments.size();
+
+    ChunkData total;
+    try {
+        std::vector<int> list;
+        AffinityPolicy policy = parsePolicy(affinity, list);
+        std::vector<int> cpus = placeThreads(policy, threads, list);
+        if (!cpus.empty()) {
+            std::cout << "The threads run on CPUs";
+            for (int cpu: cpus) {
+                std::cout << " " << cpu;
+            }
+            std::cout << std::endl;
+        }
+
+        // Not initialized: the pages are placed when the threads write their chunks
+        int *numbers = new int[size];
+        try {
+            total = generate > 0 ? firstTouchStatistics(numbers, size, threads, cpus, generateNumbers, nullptr)
+                                 : firstTouchStatistics(numbers, size, threads, cpus, copyNumbers, arguments.data());
+        } catch (...) {
+            delete[] numbers;
+            throw;
+        }
+        delete[] numbers;
+    } catch (const std::exception &e) {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    average = double(total.sum) / double(total.size);
+    variance = total.m2 / double(total.size);
+    standardDeviation = std::sqrt(variance);
+    min = total.min;
+    max = total.max;
+
+    std::cout << "The number of values is " << total.size << std::endl;
+    std::cout << std::setprecision(15);
+    std::cout << "The average value is " << average << std::endl;
+    std::cout << "The variance is " << variance << std::endl;
+    std::cout << "The standard deviation is " << standardDeviation << std::endl;
+    std::cout << "The minimum value is " << min << std::endl;
+    std::cout << "The maximum value is " << max << std::endl;
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
     if (argc < 2) {
         std::cout << "Please provide numbers as arguments." << std::endl;
         return 1;
     }
 
+    if (std::strncmp(argv[1], "--", 2) == 0) {
+        return runChunks(argc, argv);
+    }
+
     int size = argc - 1;
     int *numbers = new int[size];
     for (int i = 0; i < size; i++) {
@@ -84,7 +216,10 @@ int main(int argc, char *argv[]) {
         pthread_join(thread, nullptr);
     }
 
+    std::cout << std::setprecision(15);
     std::cout << "The average value is " << average << std::endl;
+    std::cout << "The variance is " << variance << std::endl;
+    std::cout << "The standard deviation is " << standardDeviation << std::endl;
     std::cout << "The minimum value is " << min << std::endl;
     std::cout << "The maximum value is " << max << std::endl;
 
@@ -0,0 +1,273 @@
+#ifndef MULTIPLETHREADLINUX_PTHREAD_STATISTICS_H
+#define MULTIPLETHREADLINUX_PTHREAD_STATISTICS_H
+
+#include <pthread.h>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "affinity.h"
+
+/**
+ * Data-parallel statistics with POSIX threads
+ *
+ * Instead of one thread per statistic, every thread reduces one contiguous chunk of the numbers
+ * into its own ChunkData, and the parent thread merges the chunks once the threads have been joined.
+ * Each chunk is padded to a cache line so that the threads do not write to the same line.
+ */
+struct alignas(64) ChunkData {
+    const int *numbers = nullptr;
+    std::size_t size = 0;
+    long long sum = 0;
+    int min = INT_MAX;
+    int max = INT_MIN;
+    double mean = 0;
+    double m2 = 0;
+};
+
+/**
+ * Merge the result of a chunk into the total (Chan et al. for the mean and m2)
+ * @param total - The merged result so far
+ * @param chunk - The chunk to merge
+ */
+inline void mergeChunk(ChunkData &total, const ChunkData &chunk) {
+    if (chunk.size == 0) {
+        return;
+    }
+    if (total.size == 0) {
+        total = chunk;
+        return;
+    }
+    double count = double(total.size + chunk.size);
+    double delta = chunk.mean - total.mean;
+    total.mean += delta * double(chunk.size) / count;
+    total.m2 += chunk.m2 + delta * delta * double(total.size) * double(chunk.size) / count;
+    total.size += chunk.size;
+    total.sum += chunk.sum;
+    total.min = chunk.min < total.min ? chunk.min : total.min;
+    total.max = chunk.max > total.max ? chunk.max : total.max;
+}
+
+/**
+ * Reduce one chunk: the 64-bit sum, the minimum, the maximum and the Welford mean and m2
+ * The chunk is processed in tiles that stay in the L1 cache, the squared differences of a tile
+ * are computed from the cache and the tile is merged like a chunk.
+ *
+ * @param param - The ChunkData of the thread
+ * @return - nullptr
+ */
+inline void *reduceChunk(void *param) {
+    auto *chunk = static_cast<ChunkData *>(param);
+    ChunkData total;
+    const std::size_t tileSize = 1024;
+    for (std::size_t begin = 0; begin < chunk->size; begin += tileSize) {
+        std::size_t end = begin + tileSize < chunk->size ? begin + tileSize : chunk->size;
+
+        ChunkData tile;
+        tile.size = end - begin;
+        for (std::size_t i = begin; i < end; i++) {
+            int value = chunk->numbers[i];
+            tile.sum += value;
+            tile.min = value < tile.min ? value : tile.min;
+            tile.max = value > tile.max ? value : tile.max;
+        }
+        tile.mean = double(tile.sum) / double(tile.size);
+        for (std::size_t i = begin; i < end; i++) {
+            double delta = chunk->numbers[i] - tile.mean;
+            tile.m2 += delta * delta;
+        }
+        mergeChunk(total, tile);
+    }
+    chunk->sum = total.sum;
+    chunk->min = total.min;
+    chunk->max = total.max;
+    chunk->mean = total.mean;
+    chunk->m2 = total.m2;
+    return nullptr;
+}
+
+/**
+ * Writes the values of a chunk
+ * @param chunk - The first value of the chunk
+ * @param first - The index of the first value in the whole array
+ * @param count - The number of values in the chunk
+ * @param context - The argument given with the function
+ */
+typedef void (*FillChunk)(int *chunk, std::size_t first, std::size_t count, const void *context);
+
+/**
+ * Fill a chunk with pseudo-random values
+ * Each value is a hash of its index, so every thread generates its chunk without the others.
+ *
+ * @param chunk - The chunk
+ * @param first - The index of its first value
+ * @param count - The number of values
+ */
+inline void generateNumbers(int *chunk, std::size_t first, std::size_t count, const void *) {
+    for (std::size_t i = 0; i < count; i++) {
+        std::uint64_t x = (first + i + 1) * 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        chunk[i] = static_cast<std::int32_t>((x ^ (x >> 31)) >> 32);
+    }
+}
+
+/**
+ * A chunk that its thread writes before reducing it
+ */
+struct PlacedChunk {
+    ChunkData data;
+    int *storage = nullptr;
+    std::size_t first = 0;
+    FillChunk fill = nullptr;
+    const void *context = nullptr;
+};
+
+/**
+ * Write a chunk, then reduce it
+ * The pages of the chunk are first touched here, so the kernel places them on the node of this thread.
+ *
+ * @param param - The PlacedChunk of the thread
+ * @return - nullptr
+ */
+inline void *fillAndReduceChunk(void *param) {
+    auto *chunk = static_cast<PlacedChunk *>(param);
+    chunk->fill(chunk->storage, chunk->first, chunk->data.size, chunk->context);
+    chunk->data.numbers = chunk->storage;
+    return reduceChunk(&chunk->data);
+}
+
+/**
+ * Thread attributes, destroyed when they go out of scope, also when setting them throws
+ */
+class ThreadAttributes {
+    pthread_attr_t attr;
+
+public:
+    ThreadAttributes() {
+        if (pthread_attr_init(&attr) != 0) {
+            throw std::runtime_error("Failed to initialize the thread attributes.");
+        }
+    }
+
+    ~ThreadAttributes() { pthread_attr_destroy(&attr); }
+
+    ThreadAttributes(const ThreadAttributes &) = delete;
+    ThreadAttributes &operator=(const ThreadAttributes &) = delete;
+
+    pthread_attr_t &get() { return attr; }
+};
+
+/**
+ * Start a thread, pinned to a CPU if the placement has one for it
+ * @param id - Set to the thread
+ * @param cpus - The CPU of each thread, empty for no placement
+ * @param index - The index of the thread
+ * @param routine - The thread function
+ * @param arg - The argument of the thread function
+ */
+inline void createPlacedThread(pthread_t &id, const std::vector<int> &cpus, unsigned index,
+                               void *(*routine)(void *), void *arg) {
+    ThreadAttributes attr;
+    if (!cpus.empty()) {
+        setThreadCpu(attr.get(), cpus[index % cpus.size()]);
+    }
+    int error = pthread_create(&id, &attr.get(), routine, arg);
+    if (error != 0 && !cpus.empty()) {
+        throw std::runtime_error("Failed to create a thread on CPU " + std::to_string(cpus[index % cpus.size()]));
+    }
+    if (error != 0) {
+        throw std::runtime_error("Failed to create a thread.");
+    }
+}
+
+/**
+ * Join the threads that were started before a thread could not be created
+ * @param ids - The threads
+ * @param count - The number of threads started
+ */
+inline void joinThreads(const std::vector<pthread_t> &ids, unsigned count) {
+    for (unsigned t = 0; t < count; t++) {
+        pthread_join(ids[t], nullptr);
+    }
+}
+
+/**
+ * Calculate the statistics of the numbers with one pthread per chunk
+ * @param numbers - The array of numbers
+ * @param size - The size of the array
+ * @param threads - The number of threads
+ * @param cpus - The CPU of each thread, empty to let the scheduler choose
+ * @return - The merged result, its size is the number of values
+ */
+inline ChunkData pthreadStatistics(const int *numbers, std::size_t size, unsigned threads,
+                                   const std::vector<int> &cpus = {}) {
+    std::vector<ChunkData> chunks(threads);
+    std::vector<pthread_t> ids(threads);
+    for (unsigned t = 0; t < threads; t++) {
+        std::size_t begin = size * t / threads;
+        std::size_t end = size * (t + 1) / threads;
+        chunks[t].numbers = numbers + begin;
+        chunks[t].size = end - begin;
+        try {
+            createPlacedThread(ids[t], cpus, t, reduceChunk, &chunks[t]);
+        } catch (...) {
+            joinThreads(ids, t);
+            throw;
+        }
+    }
+
+    ChunkData total;
+    for (unsigned t = 0; t < threads; t++) {
+        pthread_join(ids[t], nullptr);
+        mergeChunk(total, chunks[t]);
+    }
+    return total;
+}
+
+/**
+ * Calculate the statistics with first-touch placement
+ * Every thread writes its own chunk of the array and then reduces it, on the same CPU,
+ * so each chunk lives on the NUMA node of the thread that reads it, now and in later calls with the same placement.
+ * The array must not have been written yet, e.g. freshly allocated with `new int[size]`.
+ *
+ * @param storage - The array to fill
+ * @param size - The size of the array
+ * @param threads - The number of threads
+ * @param cpus - The CPU of each thread, empty to let the scheduler choose
+ * @param fill - Writes the values of a chunk
+ * @param context - The argument of fill
+ * @return - The merged result, its size is the number of values
+ */
+inline ChunkData firstTouchStatistics(int *storage, std::size_t size, unsigned threads, const std::vector<int> &cpus,
+                                      FillChunk fill, const void *context) {
+    std::vector<PlacedChunk> chunks(threads);
+    std::vector<pthread_t> ids(threads);
+    for (unsigned t = 0; t < threads; t++) {
+        std::size_t begin = size * t / threads;
+        std::size_t end = size * (t + 1) / threads;
+        chunks[t].storage = storage + begin;
+        chunks[t].first = begin;
+        chunks[t].data.size = end - begin;
+        chunks[t].fill = fill;
+        chunks[t].context = context;
+        try {
+            createPlacedThread(ids[t], cpus, t, fillAndReduceChunk, &chunks[t]);
+        } catch (...) {
+            joinThreads(ids, t);
+            throw;
+        }
+    }
+
+    ChunkData total;
+    for (unsigned t = 0; t < threads; t++) {
+        pthread_join(ids[t], nullptr);
+        mergeChunk(total, chunks[t].data);
+    }
+    return total;
+}
+
+#endif // MULTIPLETHREADLINUX_PTHREAD_STATISTICS_H
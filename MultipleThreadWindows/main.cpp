@@ -1,5 +1,7 @@
 #include <iostream>
+#include <iomanip>
 #include <windows.h>
+#include <cmath>
 
 /**
  * Write a multi-threaded program that calculates various statistical values for a list of numbers.
@@ -14,10 +16,15 @@
  * - The maximum value is 95.
  * The variables representing the average, minimum, and maximum values will be stored globally.
  * The worker threads will set these values, and the parent thread will output the values once the workers have exited.
+ *
+ * The average thread also reports the variance and the standard deviation.
+ * They are computed in the same pass with Welford's algorithm, and the sum is kept in 64 bits so it cannot overflow.
  */
 
 // Global variables
-int average = 0;
+double average = 0;
+double variance = 0;
+double standardDeviation = 0;
 int min = 0;
 int max = 0;
 
@@ -30,17 +37,24 @@ struct ThreadData {
 };
 
 /**
- * Calculate the average value of the numbers
+ * Calculate the average value, the variance and the standard deviation of the numbers
  * @param param - The ThreadData structure
  * @return - The exit code
  */
 DWORD WINAPI calculateAverage(LPVOID param) {
     auto *data = static_cast<ThreadData *>(param);
-    double sum = 0;
+    long long sum = 0;
+    double mean = 0;
+    double m2 = 0;
     for (int i = 0; i < data->size; i++) {
         sum += data->numbers[i];
+        double delta = data->numbers[i] - mean;
+        mean += delta / (i + 1);
+        m2 += delta * (data->numbers[i] - mean);
     }
-    average = int(sum / data->size);
+    average = double(sum) / data->size;
+    variance = m2 / data->size;
+    standardDeviation = std::sqrt(variance);
     return 0;
 }
 
@@ -125,7 +139,10 @@ int main(int argc, char *argv[]) {
 
     WaitForMultipleObjects(3, threads, TRUE, INFINITE);
 
+    std::cout << std::setprecision(15);
     std::cout << "The average value is " << average << std::endl;
+    std::cout << "The variance is " << variance << std::endl;
+    std::cout << "The standard deviation is " << standardDeviation << std::endl;
     std::cout << "The minimum value is " << min << std::endl;
     std::cout << "The maximum value is " << max << std::endl;
 
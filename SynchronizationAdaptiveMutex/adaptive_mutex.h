@@ -0,0 +1,121 @@
+#ifndef SYNCHRONIZATIONADAPTIVEMUTEX_ADAPTIVE_MUTEX_H
+#define SYNCHRONIZATIONADAPTIVEMUTEX_ADAPTIVE_MUTEX_H
+
+#include <atomic>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Adaptive (spin-then-park) mutex
+ *
+ * The spin lock of SynchronizationMutexLocks waits with `while (!available.exchange(false));`:
+ * a waiter keeps a core busy for as long as the holder keeps the lock, even when the holder is sleeping.
+ * A lock that is only held for a moment is best waited for by spinning, a lock held for long by sleeping,
+ * and the waiter cannot know which one it is. So it spins for a bounded time first and then sleeps in the kernel:
+ *
+ * 1. Spin: test-and-test-and-set. The flag is only read while it is taken, which keeps the cache line shared
+ *    instead of writing it on every attempt, and the exchange is only tried once the flag looks free.
+ *    Between reads the thread executes `pause`, doubling the number of pauses after every failed attempt
+ *    (exponential backoff) so that the waiters do not all retry at the same moment.
+ * 2. Park: after a fixed number of attempts the thread marks the lock as contended and sleeps on it
+ *    with the Linux futex system call (C++20 `atomic::wait` elsewhere). A sleeping thread uses no CPU.
+ *
+ * The state is 0 (free), 1 (taken, nobody sleeping) or 2 (taken, maybe someone sleeping), as in Drepper's
+ * "Futexes Are Tricky". Only unlocking a lock in state 2 pays for the wake-up system call,
+ * so an uncontended lock and unlock are a compare-and-swap and an exchange.
+ */
+class AdaptiveMutex {
+    std::atomic<int> state{0};
+
+    // About 800 pauses before parking, a few microseconds to tens of microseconds depending on the processor,
+    // which is in the order of the cost of sleeping and being woken up
+    static const int spinAttempts = 10;
+    static const int maxBackoff = 256;    // Pauses between two attempts at most
+
+    static void pause() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+        _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+        asm volatile("yield");
+#endif
+    }
+
+    /**
+     * Sleep while the state is 2
+     */
+    void park() {
+#ifdef __linux__
+        static_assert(sizeof(std::atomic<int>) == sizeof(int), "The futex word is the atomic int itself");
+        // Returns at once if the state is no longer 2, so a wake-up between the check and the sleep is not lost
+        syscall(SYS_futex, reinterpret_cast<int *>(&state), FUTEX_WAIT_PRIVATE, 2, nullptr, nullptr, 0);
+#elif defined(__cpp_lib_atomic_wait)
+        state.wait(2, std::memory_order_relaxed);
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    /**
+     * Wake one sleeping thread
+     */
+    void wake() {
+#ifdef __linux__
+        syscall(SYS_futex, reinterpret_cast<int *>(&state), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#elif defined(__cpp_lib_atomic_wait)
+        state.notify_one();
+#endif
+    }
+
+public:
+    AdaptiveMutex() = default;
+    AdaptiveMutex(const AdaptiveMutex &) = delete;
+    AdaptiveMutex &operator=(const AdaptiveMutex &) = delete;
+
+    bool try_lock() {
+        int expected = 0;
+        return state.compare_exchange_strong(expected, 1, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    void lock() {
+        if (try_lock()) {
+            return;
+        }
+
+        // Spin phase
+        int backoff = 1;
+        for (int attempt = 0; attempt < spinAttempts; attempt++) {
+            for (int i = 0; i < backoff; i++) {
+                pause();
+            }
+            if (backoff < maxBackoff) {
+                backoff *= 2;
+            }
+            // Test before test-and-set, a read does not take the cache line away from the holder
+            if (state.load(std::memory_order_relaxed) == 0 && try_lock()) {
+                return;
+            }
+        }
+
+        // Park phase: a thread taking the lock from here leaves it in state 2, as there may be more sleepers
+        while (state.exchange(2, std::memory_order_acquire) != 0) {
+            park();
+        }
+    }
+
+    void unlock() {
+        if (state.exchange(0, std::memory_order_release) == 2) {
+            wake();
+        }
+    }
+};
+
+#endif // SYNCHRONIZATIONADAPTIVEMUTEX_ADAPTIVE_MUTEX_H
@@ -0,0 +1,150 @@
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <ctime>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+#include "adaptive_mutex.h"
+
+/**
+ * The spin lock of SynchronizationMutexLocks, the baseline
+ */
+class SpinLock {
+    std::atomic<bool> available{true};
+
+public:
+    void lock() {
+        // Busy wait: 當 available 不為 true 時, 繼續等待
+        while (!available.exchange(false)) ;
+    }
+
+    void unlock() {
+        available.store(true);
+    }
+};
+
+/**
+ * The CPU time used by the calling thread
+ *
+ * @return - The seconds of CPU time, user and system.
+ */
+double threadCpuSeconds() {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user);
+    auto ticks = [](const FILETIME &time) {
+        return (static_cast<unsigned long long>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+    return double(ticks(kernel) + ticks(user)) * 1e-7;
+#else
+    timespec time{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return double(time.tv_sec) + double(time.tv_nsec) * 1e-9;
+#endif
+}
+
+/**
+ * The time a thread spent waiting for the lock
+ */
+struct WaitTime {
+    double wallSeconds = 0;
+    double cpuSeconds = 0;
+};
+
+/**
+ * 模擬關鍵區段: 持有鎖的執行緒睡眠，等待者不應該因此佔用 CPU
+ *
+ * @param id 執行緒 ID
+ */
+void critical_section(int id) {
+    std::cout << "Thread " << id << " entered critical section." << std::endl;
+    std::this_thread::sleep_for(std::chrono::milliseconds(300)); // 模擬耗時操作
+    std::cout << "Thread " << id << " exiting critical section." << std::endl;
+}
+
+/**
+ * 每個執行緒多次進入關鍵區段，並記錄等待鎖所花的時間與 CPU 時間
+ *
+ * @param lock The lock
+ * @param id 執行緒 ID
+ * @param wait Receives the waiting time of the thread
+ */
+template<typename Lock>
+void thread_function(Lock &lock, int id, WaitTime &wait) {
+    for (int i = 0; i < 2; i++) {
+        auto start = std::chrono::steady_clock::now();
+        double cpuStart = threadCpuSeconds();
+        lock.lock();
+        wait.cpuSeconds += threadCpuSeconds() - cpuStart;
+        wait.wallSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        critical_section(id);
+        lock.unlock();
+    }
+}
+
+/**
+ * Run the threads with a lock and report how much CPU time the waiting cost
+ *
+ * @param name The name of the lock
+ * @param num_threads The number of threads
+ */
+template<typename Lock>
+void run(const char *name, int num_threads) {
+    std::cout << name << ":" << std::endl;
+    Lock lock;
+    std::vector<WaitTime> waits(num_threads);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; i++) {
+        threads.emplace_back(thread_function<Lock>, std::ref(lock), i + 1, std::ref(waits[i]));
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    WaitTime total;
+    for (const auto &wait : waits) {
+        total.wallSeconds += wait.wallSeconds;
+        total.cpuSeconds += wait.cpuSeconds;
+    }
+    std::cout << std::fixed << std::setprecision(3) << name << " waited " << total.wallSeconds
+              << " s in total and used " << total.cpuSeconds << " s of CPU time for it ("
+              << std::setprecision(1) << (total.wallSeconds > 0 ? 100 * total.cpuSeconds / total.wallSeconds : 0)
+              << "%)" << std::endl << std::endl;
+}
+
+int main() {
+    const int num_threads = 3;
+
+    run<SpinLock>("Spin lock", num_threads);
+    run<AdaptiveMutex>("Adaptive mutex", num_threads);
+    run<std::mutex>("std::mutex", num_threads);
+
+    return 0;
+}
+
+/**
+ * 互斥執行:
+ * - 取得鎖一定要把 state 從 0 改成 1 或 2，原子操作保證同時只有一個執行緒成功。
+ *
+ * 進展:
+ * - 鎖空閒時，第一次 compare-and-swap 就會成功，不需要進入核心。
+ *
+ * 有界等待:
+ * - 與自旋鎖相同，這個實現不保證有界等待，被喚醒的執行緒仍然要和正在自旋的執行緒競爭。
+ *
+ * CPU 使用:
+ * - 自旋鎖的等待者在持有者睡眠的整段時間裡都在執行 exchange，每個等待者佔滿一個核心。
+ * - Adaptive mutex 只自旋一小段時間 (test-and-test-and-set + pause + exponential backoff)，
+ *   之後用 futex 在核心中睡眠，直到持有者釋放鎖時把它喚醒，等待期間幾乎不使用 CPU。
+ */
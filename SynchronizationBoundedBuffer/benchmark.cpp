@@ -0,0 +1,440 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "mpmc_queue.h"
+#include "spsc_ring_buffer.h"
+
+/**
+ * Bounded buffer benchmark
+ *
+ * One producer and one consumer thread pass consecutive numbers through a buffer of 1024 slots for a fixed time.
+ * The consumer checks that it receives every number once and in order. Each buffer is run with single items
+ * and with batches of 8 and 64 items per push and pop. For each run it reports:
+ * - the messages per second, in millions
+ * - the round-trip latency: one thread sends a message through one buffer and the other sends it back
+ *   through a second one, the median and the 99th percentile in nanoseconds
+ * - whether every message arrived in order
+ *
+ * locked is the same ring with a std::mutex around every operation, the simplest correct fix of the buffer
+ * in SynchronizationIssueSharedMemory. spsc is the lock-free SpscRingBuffer.
+ * A thread that finds the buffer full or empty spins for a while on several cores, and yields at once on one core,
+ * where the other thread cannot make progress until it gets the CPU.
+ *
+ * A second table runs n producers and n consumers, n = 1, 2, 4, ... up to the maximum, with blocking push and pop
+ * on a queue of 1024 slots. The consumers check that the sum of the received numbers is the sum of the sent ones.
+ * It reports the messages per second and the CPU time of the process as a percentage of the elapsed time,
+ * which stays low when the waiting threads sleep instead of spinning. condvar is a ring with one mutex
+ * and two condition variables, mpmc the lock-free MpmcQueue that sleeps on a futex.
+ *
+ * Usage:
+ * ```bash
+ * ./SynchronizationBoundedBufferBenchmark [milliseconds] [max threads per side]
+ * ```
+ */
+
+/**
+ * Ring buffer with a mutex, the same interface as SpscRingBuffer
+ */
+template<typename T>
+class LockedRingBuffer {
+    std::mutex mtx;
+    std::vector<T> slots;
+    std::size_t head = 0;
+    std::size_t tail = 0;
+
+public:
+    explicit LockedRingBuffer(std::size_t capacity) : slots(capacity) {}
+
+    bool try_push(T item) { return push(&item, 1) == 1; }
+
+    bool try_pop(T &item) { return pop(&item, 1) == 1; }
+
+    std::size_t push(const T *items, std::size_t count) {
+        std::lock_guard<std::mutex> lock(mtx);
+        std::size_t n = std::min(count, slots.size() - (tail - head));
+        for (std::size_t i = 0; i < n; i++) {
+            slots[(tail + i) % slots.size()] = items[i];
+        }
+        tail += n;
+        return n;
+    }
+
+    std::size_t pop(T *items, std::size_t count) {
+        std::lock_guard<std::mutex> lock(mtx);
+        std::size_t n = std::min(count, tail - head);
+        for (std::size_t i = 0; i < n; i++) {
+            items[i] = slots[(head + i) % slots.size()];
+        }
+        head += n;
+        return n;
+    }
+};
+
+/**
+ * Bounded queue with a mutex and two condition variables, the textbook bounded buffer
+ */
+template<typename T>
+class ConditionVariableQueue {
+    std::mutex mtx;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+    std::vector<T> slots;
+    std::size_t head = 0;
+    std::size_t tail = 0;
+
+public:
+    explicit ConditionVariableQueue(std::size_t capacity) : slots(capacity) {}
+
+    void push(T item) {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (tail - head == slots.size()) {
+            notFull.wait(lock);
+        }
+        slots[tail++ % slots.size()] = std::move(item);
+        lock.unlock();
+        notEmpty.notify_one();
+    }
+
+    T pop() {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (tail == head) {
+            notEmpty.wait(lock);
+        }
+        T item = std::move(slots[head++ % slots.size()]);
+        lock.unlock();
+        notFull.notify_one();
+        return item;
+    }
+};
+
+/**
+ * Wait for the other thread: spin a while on several cores, then yield
+ */
+class Backoff {
+    static const int maxSpins;
+    int spins = 0;
+
+public:
+    void wait() {
+        if (spins < maxSpins) {
+            spins++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    void reset() { spins = 0; }
+};
+
+const int Backoff::maxSpins = std::thread::hardware_concurrency() > 1 ? 1000 : 0;
+
+const std::size_t capacity = 1024;
+
+/**
+ * The result of one run
+ */
+struct Result {
+    double messagesPerSecond;
+    double medianNanoseconds;
+    double p99Nanoseconds;
+    bool correct;
+};
+
+/**
+ * Stream consecutive numbers from a producer to a consumer
+ * @param batch - The number of items per push and pop
+ * @param duration - How long the producer sends
+ * @param correct - Cleared if a number arrives out of order
+ * @return - The messages per second
+ */
+template<typename Buffer>
+double stream(std::size_t batch, std::chrono::milliseconds duration, bool &correct) {
+    Buffer buffer(capacity);
+    std::atomic<bool> stop(false);
+    std::atomic<bool> done(false);
+    long long received = 0;
+
+    std::thread consumer([&] {
+        std::vector<long long> items(batch);
+        long long expected = 0;
+        Backoff backoff;
+        while (true) {
+            // Read done before popping, so nothing pushed before it was set is missed
+            bool last = done.load(std::memory_order_acquire);
+            std::size_t n = buffer.pop(items.data(), batch);
+            if (n == 0) {
+                if (last) {
+                    break;
+                }
+                backoff.wait();
+                continue;
+            }
+            backoff.reset();
+            for (std::size_t i = 0; i < n; i++) {
+                correct &= items[i] == expected++;
+            }
+        }
+        received = expected;
+    });
+
+    auto begin = std::chrono::steady_clock::now();
+    std::thread producer([&] {
+        std::vector<long long> items(batch);
+        long long next = 0;
+        Backoff backoff;
+        while (!stop.load(std::memory_order_relaxed)) {
+            for (std::size_t i = 0; i < batch; i++) {
+                items[i] = next + (long long) i;
+            }
+            std::size_t sent = 0;
+            while (sent < batch) {
+                std::size_t n = buffer.push(items.data() + sent, batch - sent);
+                if (n == 0) {
+                    backoff.wait();
+                } else {
+                    backoff.reset();
+                    sent += n;
+                }
+            }
+            next += (long long) batch;
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    std::this_thread::sleep_for(duration);
+    stop.store(true);
+    producer.join();
+    consumer.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return double(received) / seconds;
+}
+
+/**
+ * Send a message back and forth between two threads through two buffers
+ * @param duration - How long they send
+ * @param correct - Cleared if a wrong message comes back
+ * @return - The round-trip times in nanoseconds, sorted
+ */
+template<typename Buffer>
+std::vector<double> pingPong(std::chrono::milliseconds duration, bool &correct) {
+    Buffer ping(capacity);
+    Buffer pong(capacity);
+    std::atomic<bool> stop(false);
+
+    std::thread echo([&] {
+        Backoff backoff;
+        long long message;
+        while (true) {
+            if (!ping.try_pop(message)) {
+                backoff.wait();
+                continue;
+            }
+            backoff.reset();
+            while (!pong.try_push(message)) {
+                backoff.wait();
+            }
+            if (message < 0) {
+                break;
+            }
+        }
+    });
+
+    std::vector<double> samples;
+    auto end = std::chrono::steady_clock::now() + duration;
+    Backoff backoff;
+    for (long long i = 0; std::chrono::steady_clock::now() < end; i++) {
+        auto sent = std::chrono::steady_clock::now();
+        while (!ping.try_push(i)) {
+            backoff.wait();
+        }
+        long long message;
+        while (!pong.try_pop(message)) {
+            backoff.wait();
+        }
+        backoff.reset();
+        samples.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - sent).count());
+        correct &= message == i;
+    }
+    // Stop the echo thread
+    long long message = -1;
+    while (!ping.try_push(message)) {
+        backoff.wait();
+    }
+    while (!pong.try_pop(message)) {
+        backoff.wait();
+    }
+    echo.join();
+
+    std::sort(samples.begin(), samples.end());
+    return samples;
+}
+
+/**
+ * @param batch - The number of items per push and pop
+ * @param duration - How long each part runs
+ * @return - The throughput, and the round-trip latency for single items
+ */
+template<typename Buffer>
+Result run(std::size_t batch, std::chrono::milliseconds duration) {
+    bool correct = true;
+    Result result{stream<Buffer>(batch, duration, correct), 0, 0, true};
+    if (batch == 1) {
+        std::vector<double> samples = pingPong<Buffer>(duration, correct);
+        if (!samples.empty()) {
+            result.medianNanoseconds = samples[samples.size() / 2];
+            result.p99Nanoseconds = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+        }
+    }
+    result.correct = correct;
+    return result;
+}
+
+/**
+ * The result of a run with many producers and consumers
+ */
+struct ManyResult {
+    double messagesPerSecond;
+    double cpuPercent;
+    bool correct;
+};
+
+/**
+ * Let n producers push numbers and n consumers pop them for a while, with blocking push and pop
+ * @param threads - The number of producers, and of consumers
+ * @param duration - How long the producers send
+ * @return - The messages per second, the CPU usage and whether the sums matched
+ */
+template<typename Queue>
+ManyResult runMany(int threads, std::chrono::milliseconds duration) {
+    Queue queue(capacity);
+    std::atomic<int> ready(0);
+    std::atomic<bool> start(false);
+    std::atomic<bool> stop(false);
+    std::atomic<long long> sent(0);
+    std::atomic<long long> sentSum(0);
+    std::atomic<long long> received(0);
+    std::atomic<long long> receivedSum(0);
+
+    std::vector<std::thread> producers;
+    std::vector<std::thread> consumers;
+    for (int t = 0; t < threads; t++) {
+        consumers.emplace_back([&] {
+            long long count = 0;
+            long long sum = 0;
+            while (true) {
+                long long message = queue.pop();
+                if (message < 0) {
+                    break;
+                }
+                count++;
+                sum += message;
+            }
+            received += count;
+            receivedSum += sum;
+        });
+        producers.emplace_back([&, t] {
+            ready++;
+            while (!start.load()) {
+                std::this_thread::yield();
+            }
+            long long count = 0;
+            long long sum = 0;
+            for (long long message = t; !stop.load(std::memory_order_relaxed); message += threads) {
+                queue.push(message);
+                count++;
+                sum += message;
+            }
+            sent += count;
+            sentSum += sum;
+        });
+    }
+    while (ready.load() < threads) {
+        std::this_thread::yield();
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    std::clock_t cpuBegin = std::clock();
+    start.store(true);
+    std::this_thread::sleep_for(duration);
+    stop.store(true);
+    for (auto &producer: producers) {
+        producer.join();
+    }
+    // One end marker for every consumer
+    for (int t = 0; t < threads; t++) {
+        queue.push(-1);
+    }
+    for (auto &consumer: consumers) {
+        consumer.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    double cpuSeconds = double(std::clock() - cpuBegin) / CLOCKS_PER_SEC;
+    return {double(received.load()) / seconds, 100 * cpuSeconds / seconds,
+            received.load() == sent.load() && receivedSum.load() == sentSum.load()};
+}
+
+/**
+ * Print the result of a buffer
+ * @param name - The name of the buffer
+ * @param batch - The number of items per push and pop
+ * @param result - The result
+ */
+void report(const char *name, std::size_t batch, const Result &result) {
+    std::cout << std::setw(10) << name << std::setw(8) << batch << std::fixed << std::setprecision(2)
+              << std::setw(14) << result.messagesPerSecond / 1e6;
+    if (batch == 1) {
+        std::cout << std::setprecision(0) << std::setw(14) << result.medianNanoseconds << std::setw(14)
+                  << result.p99Nanoseconds;
+    } else {
+        std::cout << std::setw(14) << "-" << std::setw(14) << "-";
+    }
+    std::cout << (result.correct ? "" : "  messages lost or out of order") << std::endl;
+}
+
+/**
+ * Print the result of a queue with many producers and consumers
+ * @param name - The name of the queue
+ * @param threads - The number of producers, and of consumers
+ * @param result - The result
+ */
+void report(const char *name, int threads, const ManyResult &result) {
+    std::cout << std::setw(10) << name << std::setw(8) << threads << std::fixed << std::setprecision(2)
+              << std::setw(14) << result.messagesPerSecond / 1e6 << std::setprecision(0) << std::setw(10)
+              << result.cpuPercent << (result.correct ? "" : "  messages lost or duplicated") << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    std::chrono::milliseconds duration(argc > 1 ? std::atoi(argv[1]) : 500);
+    int maxThreads = argc > 2 ? std::atoi(argv[2]) : 32;
+    if (duration.count() <= 0 || maxThreads < 1) {
+        std::cout << "Usage: SynchronizationBoundedBufferBenchmark [milliseconds] [max threads per side]" << std::endl;
+        return 1;
+    }
+
+    std::cout << std::thread::hardware_concurrency() << " hardware thread(s), " << duration.count()
+              << " ms per run, " << capacity << " slots" << std::endl;
+    std::cout << std::setw(10) << "buffer" << std::setw(8) << "batch" << std::setw(14) << "Mmsg/s"
+              << std::setw(14) << "p50 rtt ns" << std::setw(14) << "p99 rtt ns" << std::endl;
+    for (std::size_t batch: {std::size_t(1), std::size_t(8), std::size_t(64)}) {
+        report("locked", batch, run<LockedRingBuffer<long long>>(batch, duration));
+        report("spsc", batch, run<SpscRingBuffer<long long>>(batch, duration));
+    }
+
+    std::cout << std::endl << "Many producers and consumers" << std::endl;
+    std::cout << std::setw(10) << "queue" << std::setw(8) << "n" << std::setw(14) << "Mmsg/s" << std::setw(10)
+              << "cpu %" << std::endl;
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        report("condvar", threads, runMany<ConditionVariableQueue<long long>>(threads, duration));
+        report("mpmc", threads, runMany<MpmcQueue<long long>>(threads, duration));
+    }
+    return 0;
+}
@@ -0,0 +1,163 @@
+#include <iostream>
+#include <thread>
+#include <random>
+#include <mutex>
+#include <vector>
+
+#include "mpmc_queue.h"
+#include "spsc_ring_buffer.h"
+
+#define BUFFER_SIZE 8      // 必須是 2 的次方
+#define NUM_ITEMS 20
+
+// 共用的 buffer，in/out 變成 buffer 內部的 tail/head，不再需要 counter
+SpscRingBuffer<int> buffer(BUFFER_SIZE);
+
+// 多個 producer 和 consumer 共用的 buffer
+MpmcQueue<int> sharedQueue(BUFFER_SIZE);
+
+// Mutex for protecting output
+std::mutex output_mutex;
+
+/**
+ * Producer function that writes to the shared buffer.
+ * Produces NUM_ITEMS items one at a time.
+ * Yields the CPU while the buffer is full instead of busy waiting.
+ */
+void producer() {
+    // Random number generator for producing items
+    std::mt19937 gen(std::random_device{}());
+
+    for (int i = 0; i < NUM_ITEMS; i++) {
+        int nextProduced = static_cast<int>(gen() % 100);
+
+        // Wait while buffer is full
+        while (!buffer.try_push(nextProduced)) {
+            std::this_thread::yield();
+        }
+
+        std::lock_guard<std::mutex> guard(output_mutex);
+        std::cout << "Produced: " << nextProduced << std::endl;
+    }
+}
+
+/**
+ * Consumer function that reads from the shared buffer.
+ * Consumes NUM_ITEMS items, taking up to four at once with a bulk pop.
+ * Yields the CPU while the buffer is empty.
+ */
+void consumer() {
+    int nextConsumed[4];
+    int consumed = 0;
+    while (consumed < NUM_ITEMS) {
+        // Wait while buffer is empty
+        std::size_t n = buffer.pop(nextConsumed, 4);
+        if (n == 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        consumed += static_cast<int>(n);
+
+        std::lock_guard<std::mutex> guard(output_mutex);
+        std::cout << "Consumed " << n << " item(s):";
+        for (std::size_t i = 0; i < n; i++) {
+            std::cout << " " << nextConsumed[i];
+        }
+        std::cout << std::endl;
+    }
+}
+
+/**
+ * Producer function for many producers, as in SynchronizationIssueSharedMemory.
+ * Produces one item, sleeping while the queue is full.
+ *
+ * @param id The id of the producer thread
+ */
+void mpmcProducer(int id) {
+    std::mt19937 gen(std::random_device{}());
+    int nextProduced = static_cast<int>(gen() % 100);
+
+    sharedQueue.push(nextProduced);
+
+    std::lock_guard<std::mutex> guard(output_mutex);
+    std::cout << "Produced by producer " << id << ": " << nextProduced << std::endl;
+}
+
+/**
+ * Consumer function for many consumers.
+ * Consumes one item, sleeping while the queue is empty.
+ *
+ * @param id The id of the consumer thread
+ */
+void mpmcConsumer(int id) {
+    int nextConsumed = sharedQueue.pop();
+
+    std::lock_guard<std::mutex> guard(output_mutex);
+    std::cout << "Consumed by consumer " << id << ": " << nextConsumed << std::endl;
+}
+
+/**
+ * Main function to launch one producer and one consumer thread,
+ * then three producers and three consumers on the multi-producer queue.
+ */
+int main() {
+    std::thread producerThread(producer);
+    std::thread consumerThread(consumer);
+
+    producerThread.join();
+    consumerThread.join();
+
+    const int num_producers = 3;  // Number of producer threads
+    const int num_consumers = 3;  // Number of consumer threads
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_producers + num_consumers);
+    // Start the consumers first, they sleep until an item arrives
+    for (int i = 0; i < num_consumers; i++) {
+        threads.emplace_back(mpmcConsumer, i + 1);
+    }
+    for (int i = 0; i < num_producers; i++) {
+        threads.emplace_back(mpmcProducer, i + 1);
+    }
+
+    for (auto &thread: threads) {
+        thread.join();
+    }
+
+    return 0;
+}
+
+/**
+ * 與 SynchronizationIssueSharedMemory 的比較
+ * 同一個有界緩衝區，但只有一個 producer 和一個 consumer，這樣就不需要鎖：
+ *   1. tail (原本的 in) 只有 producer 會寫，head (原本的 out) 只有 consumer 會寫
+ *   2. 項目數量就是 tail - head，因此不需要兩邊都會修改的 counter，也就沒有 counter++ 的 Race Condition
+ *   3. 容量是 2 的次方，位置 = 索引 & (容量 - 1)，索引可以一直遞增
+ *
+ * 記憶體順序 (Memory Order)：
+ *   producer 先寫入 buffer[tail]，再以 release 寫入 tail
+ *   consumer 以 acquire 讀取 tail，之後才讀 buffer，因此一定能看到完整寫入的項目
+ *   原本的程式中 buffer[in] 和 counter 都是普通變數，編譯器和 CPU 都可以重新排序，consumer 可能讀到舊的值
+ *
+ * 快取行 (Cache Line)：
+ *   head 和 tail 放在不同的快取行，避免 False Sharing
+ *   每一方還會保存對方索引的副本，只有副本顯示已滿 (或已空) 時才重新讀取，平常不會碰到對方寫入的快取行
+ *
+ * 批次操作：
+ *   pop(items, n) 一次取出多個項目，只讀寫一次索引
+ *
+ * 限制：
+ *   只能有一個 producer 和一個 consumer，多個 producer 同時寫 tail 仍然會互相覆蓋
+ *   原本 3 個 producer 和 3 個 consumer 的情況需要多生產者多消費者 (MPMC) 的佇列
+ *
+ * 多生產者多消費者 (MpmcQueue)：
+ *   每個格子有一個序號 (sequence)，表示這個格子目前可以給哪一個位置的 producer 寫入或 consumer 讀取
+ *   1. producer 用 compare-and-swap 搶下 enqueuePos 的位置，寫入後把序號設成 pos + 1，consumer 才能讀
+ *   2. consumer 用 compare-and-swap 搶下 dequeuePos 的位置，讀取後把序號設成 pos + 容量，下一輪的 producer 才能寫
+ *   3. 搶不到位置只代表別的執行緒已經完成了它的操作，因此不會有執行緒卡在別人的操作中間
+ *
+ * 等待：
+ *   佇列已滿或已空時，先短暫重試 (多核心時)，再用 futex 睡眠，不會像 while (counter == 0); 一樣佔用 CPU
+ *   睡眠前先在 eventCount 設定最低位元，另一方成功操作後只有看到這個位元時才清除它並進入 kernel 喚醒，平常不需要系統呼叫
+ *   futex 只在 eventCount 沒有改變時才睡眠，因此設定位元後、睡眠前的喚醒不會遺失
+ */
@@ -0,0 +1,229 @@
+#ifndef SYNCHRONIZATIONBOUNDEDBUFFER_MPMC_QUEUE_H
+#define SYNCHRONIZATIONBOUNDEDBUFFER_MPMC_QUEUE_H
+
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * Bounded multi-producer/multi-consumer queue (Vyukov)
+ *
+ * SpscRingBuffer relies on a single writer per index. With several producers they have to agree on who
+ * writes which slot, and a consumer must not read a slot that a producer has claimed but not yet written.
+ * Every slot therefore carries a sequence number:
+ * - Slot i starts with sequence i. A producer at position `pos` may write slot pos & mask when its sequence is pos.
+ *   It claims the position with a compare-and-swap of `enqueuePos`, writes the item, and then publishes it
+ *   by storing pos + 1 (release).
+ * - A consumer at position `pos` may read the slot when its sequence is pos + 1. It claims the position
+ *   with a compare-and-swap of `dequeuePos`, reads the item, and frees the slot for the next round
+ *   by storing pos + capacity.
+ * - A sequence below the position means the slot is still in use from the previous round: the queue is full
+ *   (or empty). A sequence above it means another thread already took this position, so reload it.
+ * Producers only contend on `enqueuePos`, consumers only on `dequeuePos`, and a producer and a consumer
+ * only meet on a slot. No thread ever waits for another one in the middle of an operation.
+ *
+ * try_push and try_pop fail at once when the queue is full or empty. push and pop wait instead:
+ * they retry for a short while, then sleep on a futex until the other side makes room or adds an item,
+ * as FutexSemaphore does. The futex word of a side is an event count: a counter of wake-ups shifted left by one,
+ * and the lowest bit set while a thread sleeps there or is about to. It is unsigned, so the counter wraps around
+ * when it overflows, and the futex only compares the bits.
+ * - A thread that is about to sleep sets the bit, retries once more and then sleeps only while the word
+ *   still has the value it set, so a wake-up in between is not lost.
+ * - The other side checks the bit after every successful operation. Only if it is set does it bump the counter,
+ *   clearing the bit, and wake all sleepers of the side. The woken threads retry and set the bit again
+ *   if they still have to wait, so until then the following operations do not enter the kernel at all.
+ * Each side puts a sequentially consistent fence between its own operation and reading the other side's word,
+ * so either the sleeper sees the change or the waker sees the bit.
+ * @tparam T - The item, default-constructible and move-assignable
+ */
+template<typename T>
+class MpmcQueue {
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        T data;
+    };
+
+    /**
+     * The sleepers on one side of the queue
+     */
+    struct alignas(64) Parking {
+        std::atomic<unsigned> eventCount{0};
+    };
+
+    static_assert(sizeof(std::atomic<unsigned>) == sizeof(int), "The futex word is the atomic unsigned itself");
+
+    alignas(64) std::atomic<std::size_t> enqueuePos{0};
+    alignas(64) std::atomic<std::size_t> dequeuePos{0};
+    Parking notFull;
+    Parking notEmpty;
+    alignas(64) std::size_t mask;
+    std::unique_ptr<Cell[]> cells;
+
+    static long futex(std::atomic<unsigned> &word, int operation, unsigned value) {
+        return syscall(SYS_futex, reinterpret_cast<unsigned *>(&word), operation, value, nullptr, nullptr, 0);
+    }
+
+    /**
+     * Wake the sleepers of a side, if there are any
+     */
+    static void wake(Parking &parking) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        unsigned events = parking.eventCount.load(std::memory_order_relaxed);
+        while (events & 1u) {
+            // Adding one clears the bit and carries into the counter
+            if (parking.eventCount.compare_exchange_weak(events, events + 1u, std::memory_order_release,
+                                                         std::memory_order_relaxed)) {
+                futex(parking.eventCount, FUTEX_WAKE_PRIVATE, INT_MAX);
+                return;
+            }
+        }
+    }
+
+    /**
+     * Retry an operation until it succeeds, spinning first and then sleeping on a side
+     * @param parking - Where to sleep, woken by the other side
+     * @param attempt - The operation, true on success
+     */
+    template<typename Attempt>
+    static void await(Parking &parking, Attempt attempt) {
+        // On a single processor the other side cannot run during the spin, so there is only the first try
+        static const int maxSpins = std::thread::hardware_concurrency() > 1 ? 100 : 1;
+        for (int spins = 0; spins < maxSpins; spins++) {
+            if (attempt()) {
+                return;
+            }
+#if defined(__x86_64__) || defined(__i386__)
+            _mm_pause();
+#endif
+        }
+        while (true) {
+            unsigned events = parking.eventCount.fetch_or(1u, std::memory_order_relaxed) | 1u;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (attempt()) {
+                return;
+            }
+            // Returns at once if the other side woke this side since the bit was set
+            futex(parking.eventCount, FUTEX_WAIT_PRIVATE, events);
+            if (attempt()) {
+                return;
+            }
+        }
+    }
+
+    bool tryPushNoWake(T &item) {
+        std::size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell &cell = cells[pos & mask];
+            std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(sequence - pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.data = std::move(item);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPopNoWake(T &item) {
+        std::size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell &cell = cells[pos & mask];
+            std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(sequence - (pos + 1));
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    item = std::move(cell.data);
+                    cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+public:
+    /**
+     * @param capacity - The number of items, a power of two and at least 2
+     */
+    explicit MpmcQueue(std::size_t capacity) {
+        if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+            throw std::invalid_argument("The capacity of the queue must be a power of two and at least 2.");
+        }
+        mask = capacity - 1;
+        cells.reset(new Cell[capacity]);
+        for (std::size_t i = 0; i < capacity; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpmcQueue(const MpmcQueue &) = delete;
+    MpmcQueue &operator=(const MpmcQueue &) = delete;
+
+    std::size_t capacity() const { return mask + 1; }
+
+    /**
+     * @param item - The item
+     * @return - False if the queue is full
+     */
+    bool try_push(T item) {
+        if (!tryPushNoWake(item)) {
+            return false;
+        }
+        wake(notEmpty);
+        return true;
+    }
+
+    /**
+     * @param item - Receives the item
+     * @return - False if the queue is empty
+     */
+    bool try_pop(T &item) {
+        if (!tryPopNoWake(item)) {
+            return false;
+        }
+        wake(notFull);
+        return true;
+    }
+
+    /**
+     * Push an item, waiting while the queue is full
+     * @param item - The item
+     */
+    void push(T item) {
+        await(notFull, [&] { return tryPushNoWake(item); });
+        wake(notEmpty);
+    }
+
+    /**
+     * Pop an item, waiting while the queue is empty
+     * @return - The item
+     */
+    T pop() {
+        T item;
+        await(notEmpty, [&] { return tryPopNoWake(item); });
+        wake(notFull);
+        return item;
+    }
+};
+
+#endif // SYNCHRONIZATIONBOUNDEDBUFFER_MPMC_QUEUE_H
@@ -0,0 +1,156 @@
+#ifndef SYNCHRONIZATIONBOUNDEDBUFFER_SPSC_RING_BUFFER_H
+#define SYNCHRONIZATIONBOUNDEDBUFFER_SPSC_RING_BUFFER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+/**
+ * Lock-free single-producer/single-consumer ring buffer
+ *
+ * The bounded buffer of SynchronizationIssueSharedMemory keeps `in`, `out` and `counter` in plain ints:
+ * `counter++` and `counter--` race, and nothing orders the write of `buffer[in]` before the consumer reads it.
+ * With one producer and one consumer no counter is needed at all:
+ * - `tail` is only written by the producer, `head` only by the consumer. Both only grow, and the number of items
+ *   is tail - head, the position in the buffer is the index modulo the capacity (a mask, as it is a power of two).
+ * - The producer writes the slot and then publishes it with a release store of `tail`, the consumer loads `tail`
+ *   with acquire before it reads the slot, so it always sees the item. The same holds for `head` the other way,
+ *   so the producer only reuses a slot after the consumer has read it.
+ * - The two indices are in separate cache lines, so the producer writing `tail` does not take the line of `head`
+ *   away from the consumer. Each side also keeps a copy of the other side's index in its own line,
+ *   and only loads the real one when the copy says the buffer is full (or empty): while there is room,
+ *   a push touches no cache line the consumer writes.
+ *
+ * Bulk push and pop move several items with one load and one store of the indices.
+ * @tparam T - The item, default-constructible and move-assignable
+ */
+template<typename T>
+class SpscRingBuffer {
+    // Producer side
+    alignas(64) std::atomic<std::size_t> tail{0};
+    std::size_t headCache = 0;
+
+    // Consumer side
+    alignas(64) std::atomic<std::size_t> head{0};
+    std::size_t tailCache = 0;
+
+    // Shared, read only
+    alignas(64) std::size_t mask;
+    std::unique_ptr<T[]> slots;
+
+    /**
+     * @param tailIndex - The producer's tail
+     * @param wanted - The number of slots the producer needs
+     * @return - The number of free slots, loading the consumer's head only if the cached one shows fewer than wanted
+     */
+    std::size_t freeSlots(std::size_t tailIndex, std::size_t wanted) {
+        std::size_t free = capacity() - (tailIndex - headCache);
+        if (free < wanted) {
+            headCache = head.load(std::memory_order_acquire);
+            free = capacity() - (tailIndex - headCache);
+        }
+        return free;
+    }
+
+    /**
+     * @param headIndex - The consumer's head
+     * @param wanted - The number of items the consumer needs
+     * @return - The number of items, loading the producer's tail only if the cached one shows fewer than wanted
+     */
+    std::size_t usedSlots(std::size_t headIndex, std::size_t wanted) {
+        std::size_t used = tailCache - headIndex;
+        if (used < wanted) {
+            tailCache = tail.load(std::memory_order_acquire);
+            used = tailCache - headIndex;
+        }
+        return used;
+    }
+
+public:
+    /**
+     * @param capacity - The number of items, a power of two
+     */
+    explicit SpscRingBuffer(std::size_t capacity) {
+        if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+            throw std::invalid_argument("The capacity of the ring buffer must be a power of two.");
+        }
+        mask = capacity - 1;
+        slots.reset(new T[capacity]);
+    }
+
+    SpscRingBuffer(const SpscRingBuffer &) = delete;
+    SpscRingBuffer &operator=(const SpscRingBuffer &) = delete;
+
+    std::size_t capacity() const { return mask + 1; }
+
+    /**
+     * Called by the producer only
+     * @param item - The item
+     * @return - False if the buffer is full
+     */
+    bool try_push(T item) {
+        std::size_t t = tail.load(std::memory_order_relaxed);
+        if (freeSlots(t, 1) == 0) {
+            return false;
+        }
+        slots[t & mask] = std::move(item);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Called by the consumer only
+     * @param item - Receives the item
+     * @return - False if the buffer is empty
+     */
+    bool try_pop(T &item) {
+        std::size_t h = head.load(std::memory_order_relaxed);
+        if (usedSlots(h, 1) == 0) {
+            return false;
+        }
+        item = std::move(slots[h & mask]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Push as many of the items as there is room for, called by the producer only
+     * @param items - The items
+     * @param count - The number of items
+     * @return - The number of items pushed, from the front
+     */
+    std::size_t push(const T *items, std::size_t count) {
+        std::size_t t = tail.load(std::memory_order_relaxed);
+        std::size_t n = std::min(count, freeSlots(t, count));
+        for (std::size_t i = 0; i < n; i++) {
+            slots[(t + i) & mask] = items[i];
+        }
+        if (n > 0) {
+            tail.store(t + n, std::memory_order_release);
+        }
+        return n;
+    }
+
+    /**
+     * Pop up to count items, called by the consumer only
+     * @param items - Receives the items
+     * @param count - The most items to pop
+     * @return - The number of items popped
+     */
+    std::size_t pop(T *items, std::size_t count) {
+        std::size_t h = head.load(std::memory_order_relaxed);
+        std::size_t n = std::min(count, usedSlots(h, count));
+        for (std::size_t i = 0; i < n; i++) {
+            items[i] = std::move(slots[(h + i) & mask]);
+        }
+        if (n > 0) {
+            head.store(h + n, std::memory_order_release);
+        }
+        return n;
+    }
+};
+
+#endif // SYNCHRONIZATIONBOUNDEDBUFFER_SPSC_RING_BUFFER_H
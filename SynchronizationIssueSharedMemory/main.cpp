@@ -155,4 +155,5 @@ int main() {
  *   2. Non-Preemption: 進入 Critical Section 的 process 不會被中斷，直到它自己退出，在 kernel-mode 中不存在 Race Condition
  *
  *   接續到 Peterson's Solution
+ *   只有一個 producer 和一個 consumer 時，不用鎖的正確版本見 SynchronizationBoundedBuffer
  */
@@ -0,0 +1,185 @@
+#ifndef SYNCHRONIZATIONLOCKBENCHMARK_LOCKS_H
+#define SYNCHRONIZATIONLOCKBENCHMARK_LOCKS_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "semaphore.h"
+
+/**
+ * The locks of the Synchronization* demos behind one interface
+ *
+ * Every lock is constructed with the number of threads and used as `lock(id)` / `unlock(id)`
+ * with the thread ids 0 to threads - 1. Each one waits the way its demo does,
+ * so the benchmark measures the demos as they are written.
+ */
+
+/**
+ * SynchronizationTestAndSet: exchange the shared flag, yield when it was taken
+ */
+class TestAndSetLock {
+    std::atomic<bool> flag{false};
+
+public:
+    explicit TestAndSetLock(int) {}
+
+    void lock(int) {
+        while (flag.exchange(true)) {
+            std::this_thread::yield();
+        }
+    }
+
+    void unlock(int) { flag.store(false); }
+};
+
+/**
+ * SynchronizationCompareAndSwap: compare-and-swap the shared flag, yield when it was taken
+ */
+class CompareAndSwapLock {
+    std::atomic<bool> flag{false};
+
+public:
+    explicit CompareAndSwapLock(int) {}
+
+    void lock(int) {
+        bool expected = false;
+        while (!flag.compare_exchange_strong(expected, true)) {
+            expected = false;
+            std::this_thread::yield();
+        }
+    }
+
+    void unlock(int) { flag.store(false); }
+};
+
+/**
+ * SynchronizationMutexLocks: busy wait on an exchange without yielding
+ */
+class ExchangeSpinLock {
+    std::atomic<bool> available{true};
+
+public:
+    explicit ExchangeSpinLock(int) {}
+
+    void lock(int) {
+        while (!available.exchange(false)) ;
+    }
+
+    void unlock(int) { available.store(true); }
+};
+
+/**
+ * SynchronizationBoundedWaitingMutualExclusionTestAndSet: test-and-set with a waiting flag per thread,
+ * the releasing thread hands the lock to the next waiter in id order
+ */
+class BoundedWaitingLock {
+    std::atomic<bool> flag{false};
+    std::unique_ptr<std::atomic<bool>[]> waiting;
+    int n;
+
+public:
+    explicit BoundedWaitingLock(int threads) : waiting(new std::atomic<bool>[threads]), n(threads) {
+        for (int i = 0; i < n; i++) {
+            waiting[i].store(false);
+        }
+    }
+
+    void lock(int id) {
+        waiting[id].store(true);
+        bool key = true;
+        while (waiting[id].load() && key) {
+            key = flag.exchange(true);
+        }
+        waiting[id].store(false);
+    }
+
+    void unlock(int id) {
+        int j = (id + 1) % n;
+        while ((j != id) && !waiting[j].load()) {
+            j = (j + 1) % n;
+        }
+
+        if (j == id) {
+            flag.store(false);
+        } else {
+            waiting[j].store(false);
+        }
+    }
+};
+
+/**
+ * SynchronizationPetersonSolution with sequentially consistent atomics
+ *
+ * The demo uses plain `int turn` and `bool flag[2]`. The compiler may keep them in registers or reorder
+ * the store to `turn` after the load of `flag[other]`, and the processor's store buffer can do the same
+ * (a store followed by a load of another location is the one reordering x86 allows),
+ * so both threads can enter. With std::atomic and the default memory_order_seq_cst both are forbidden.
+ *
+ * Peterson's solution is for two threads, for more it is generalized as the filter lock:
+ * a thread passes n - 1 levels, each a Peterson lock between the threads at that level and above,
+ * where `victim[level]` plays the part of `turn`. Acquiring it costs O(n^2) reads.
+ */
+class PetersonLock {
+    std::unique_ptr<std::atomic<int>[]> level;
+    std::unique_ptr<std::atomic<int>[]> victim;
+    int n;
+
+public:
+    explicit PetersonLock(int threads) : level(new std::atomic<int>[threads]), victim(new std::atomic<int>[threads]),
+                                         n(threads) {
+        for (int i = 0; i < n; i++) {
+            level[i].store(0);
+            victim[i].store(-1);
+        }
+    }
+
+    void lock(int id) {
+        for (int l = 1; l < n; l++) {
+            level[id].store(l);     // flag[id] = true, at this level
+            victim[l].store(id);    // turn = other
+            // Wait while another thread is at this level or above and this thread is the victim
+            bool wait = true;
+            while (wait && victim[l].load() == id) {
+                wait = false;
+                for (int k = 0; k < n && !wait; k++) {
+                    wait = k != id && level[k].load() >= l;
+                }
+            }
+        }
+    }
+
+    void unlock(int id) { level[id].store(0); }
+};
+
+/**
+ * SynchronizationSemaphore: the Semaphore class with one slot
+ */
+class SemaphoreLock {
+    Semaphore semaphore{1};
+
+public:
+    explicit SemaphoreLock(int) {}
+
+    void lock(int) { semaphore.wait(); }
+
+    void unlock(int) { semaphore.signal(); }
+};
+
+/**
+ * std::mutex, the reference
+ */
+class StdMutexLock {
+    std::mutex mutex;
+
+public:
+    explicit StdMutexLock(int) {}
+
+    void lock(int) { mutex.lock(); }
+
+    void unlock(int) { mutex.unlock(); }
+};
+
+#endif // SYNCHRONIZATIONLOCKBENCHMARK_LOCKS_H
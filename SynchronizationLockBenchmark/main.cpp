@@ -0,0 +1,297 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "locks.h"
+
+/**
+ * Lock benchmark
+ *
+ * The Synchronization* demos sleep for seconds inside the critical section on two or three threads,
+ * which shows that the locks work but not how well. This harness runs each of their locks under load:
+ * every thread repeatedly takes the lock, does `--critical` units of work on shared data, releases it
+ * and does `--outside` units of work of its own, for `--duration` milliseconds.
+ *
+ * One CSV row per lock and thread count:
+ * - acquisitions_per_second: of all threads together
+ * - fairness_min_max: the fewest acquisitions of a thread divided by the most, 1 when all got the same share
+ * - fairness_cv: the standard deviation of the per-thread acquisitions divided by their mean, 0 when fair
+ * - handoff_mean_ns, handoff_p99_ns: the time from a release to the acquisition by another thread
+ *   that was already waiting, measured with the steady clock
+ * - correct: whether the shared counter saw every acquisition, i.e. mutual exclusion held
+ *
+ * Usage:
+ * ```bash
+ * ./SynchronizationLockBenchmark [--threads 2,4,8] [--critical N] [--outside N] [--duration MS]
+ *                                [--locks tas,cas,exchange,bounded,peterson,semaphore,mutex] [--output file.csv]
+ * ```
+ * The spinning locks wait as their demos do: with more threads than cores the exchange, bounded-waiting
+ * and Peterson locks keep spinning while the holder is not running, so keep the thread counts moderate for them.
+ */
+
+/**
+ * The options of a run
+ */
+struct Options {
+    std::vector<int> threads;
+    int critical = 16;
+    int outside = 64;
+    std::chrono::milliseconds duration{500};
+    std::vector<std::string> locks = {"tas", "cas", "exchange", "bounded", "peterson", "semaphore", "mutex"};
+    std::string output;
+};
+
+/**
+ * The data protected by the lock
+ */
+struct alignas(64) SharedData {
+    long long counter = 0;
+    long long work[8] = {};
+    // The last release, read by the next holder to measure the hand-over
+    long long releaseNanoseconds = 0;
+    int releasedBy = -1;
+};
+
+/**
+ * The result of one run
+ */
+struct Result {
+    long long acquisitions = 0;
+    double acquisitionsPerSecond = 0;
+    double fairnessMinMax = 0;
+    double fairnessCv = 0;
+    double handoffMean = 0;
+    double handoffP99 = 0;
+    bool correct = false;
+};
+
+/**
+ * @return - The steady clock in nanoseconds
+ */
+long long nowNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Work outside of the lock, on the thread's own data
+ * @param units - The amount of work
+ */
+void localWork(int units) {
+    volatile long long sink = 0;
+    for (int i = 0; i < units; i++) {
+        sink = sink + i;
+    }
+}
+
+/**
+ * Let the threads hammer a lock for a while
+ * @param threads - The number of threads
+ * @param options - The work and the duration
+ * @return - The result
+ */
+template<typename Lock>
+Result run(int threads, const Options &options) {
+    Lock lock(threads);
+    SharedData data;
+    std::atomic<int> ready(0);
+    std::atomic<bool> start(false);
+    std::atomic<bool> stop(false);
+    std::vector<long long> counts(threads, 0);
+    std::vector<std::vector<long long>> handoffs(threads);
+
+    std::vector<std::thread> workers;
+    for (int id = 0; id < threads; id++) {
+        workers.emplace_back([&, id] {
+            long long count = 0;
+            std::vector<long long> &waits = handoffs[id];
+            ready++;
+            while (!start.load()) {
+                std::this_thread::yield();
+            }
+            while (!stop.load(std::memory_order_relaxed)) {
+                long long requested = nowNanoseconds();
+                lock.lock(id);
+                long long acquired = nowNanoseconds();
+                // A hand-over: released by another thread while this one was waiting
+                if (data.releasedBy != id && data.releasedBy >= 0 && data.releaseNanoseconds >= requested) {
+                    waits.push_back(acquired - data.releaseNanoseconds);
+                }
+                data.counter++;
+                for (int i = 0; i < options.critical; i++) {
+                    data.work[i % 8] += i;
+                }
+                data.releasedBy = id;
+                data.releaseNanoseconds = nowNanoseconds();
+                lock.unlock(id);
+                count++;
+                localWork(options.outside);
+            }
+            counts[id] = count;
+        });
+    }
+    while (ready.load() < threads) {
+        std::this_thread::yield();
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true);
+    std::this_thread::sleep_for(options.duration);
+    stop.store(true);
+    for (auto &worker: workers) {
+        worker.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    Result result;
+    for (long long count: counts) {
+        result.acquisitions += count;
+    }
+    double mean = double(result.acquisitions) / threads;
+    double squares = 0;
+    for (long long count: counts) {
+        squares += (double(count) - mean) * (double(count) - mean);
+    }
+    auto extremes = std::minmax_element(counts.begin(), counts.end());
+    result.acquisitionsPerSecond = double(result.acquisitions) / std::chrono::duration<double>(end - begin).count();
+    result.fairnessMinMax = *extremes.second > 0 ? double(*extremes.first) / double(*extremes.second) : 0;
+    result.fairnessCv = mean > 0 ? std::sqrt(squares / threads) / mean : 0;
+
+    std::vector<long long> all;
+    for (const auto &waits: handoffs) {
+        all.insert(all.end(), waits.begin(), waits.end());
+    }
+    if (!all.empty()) {
+        double sum = 0;
+        for (long long wait: all) {
+            sum += double(wait);
+        }
+        result.handoffMean = sum / double(all.size());
+        auto p99 = all.begin() + static_cast<std::ptrdiff_t>(0.99 * double(all.size() - 1));
+        std::nth_element(all.begin(), p99, all.end());
+        result.handoffP99 = double(*p99);
+    }
+    result.correct = data.counter == result.acquisitions;
+    return result;
+}
+
+/**
+ * Run a lock by its name
+ * @param name - The name of the lock
+ * @param threads - The number of threads
+ * @param options - The options
+ * @param result - Receives the result
+ * @return - False if there is no lock of that name
+ */
+bool runLock(const std::string &name, int threads, const Options &options, Result &result) {
+    if (name == "tas") {
+        result = run<TestAndSetLock>(threads, options);
+    } else if (name == "cas") {
+        result = run<CompareAndSwapLock>(threads, options);
+    } else if (name == "exchange") {
+        result = run<ExchangeSpinLock>(threads, options);
+    } else if (name == "bounded") {
+        result = run<BoundedWaitingLock>(threads, options);
+    } else if (name == "peterson") {
+        result = run<PetersonLock>(threads, options);
+    } else if (name == "semaphore") {
+        result = run<SemaphoreLock>(threads, options);
+    } else if (name == "mutex") {
+        result = run<StdMutexLock>(threads, options);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Split a comma-separated list
+ * @param text - The list
+ * @return - The items
+ */
+std::vector<std::string> splitList(const std::string &text) {
+    std::vector<std::string> items;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string option = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (option == "--threads" && hasValue) {
+                for (const auto &item: splitList(argv[++i])) {
+                    options.threads.push_back(std::stoi(item));
+                }
+            } else if (option == "--critical" && hasValue) {
+                options.critical = std::stoi(argv[++i]);
+            } else if (option == "--outside" && hasValue) {
+                options.outside = std::stoi(argv[++i]);
+            } else if (option == "--duration" && hasValue) {
+                options.duration = std::chrono::milliseconds(std::stoi(argv[++i]));
+            } else if (option == "--locks" && hasValue) {
+                options.locks = splitList(argv[++i]);
+            } else if (option == "--output" && hasValue) {
+                options.output = argv[++i];
+            } else {
+                std::cout << "Unknown option " << option << std::endl;
+                return 1;
+            }
+        }
+    } catch (const std::exception &e) {
+        std::cout << "Invalid number: " << e.what() << std::endl;
+        return 1;
+    }
+    if (options.threads.empty()) {
+        options.threads = {2, 4, 8};
+    }
+    for (int threads: options.threads) {
+        if (threads < 1) {
+            std::cout << "The number of threads must be positive." << std::endl;
+            return 1;
+        }
+    }
+
+    std::ofstream file;
+    if (!options.output.empty()) {
+        file.open(options.output);
+        if (!file) {
+            std::cout << "Failed to open " << options.output << std::endl;
+            return 1;
+        }
+    }
+    std::ostream &out = options.output.empty() ? std::cout : file;
+
+    out << "lock,threads,critical_work,outside_work,duration_ms,acquisitions,acquisitions_per_second,"
+           "fairness_min_max,fairness_cv,handoff_mean_ns,handoff_p99_ns,correct" << std::endl;
+    for (const auto &name: options.locks) {
+        for (int threads: options.threads) {
+            Result result;
+            if (!runLock(name, threads, options, result)) {
+                std::cout << "Unknown lock " << name << std::endl;
+                return 1;
+            }
+            out << name << ',' << threads << ',' << options.critical << ',' << options.outside << ','
+                << options.duration.count() << ',' << result.acquisitions << ','
+                << std::llround(result.acquisitionsPerSecond) << ',' << result.fairnessMinMax << ','
+                << result.fairnessCv << ',' << std::llround(result.handoffMean) << ','
+                << std::llround(result.handoffP99) << ',' << (result.correct ? "true" : "false") << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "chandy_misra.h"
+#include "dining_philosophers.h"
+
+/**
+ * Dining philosophers benchmark
+ *
+ * The philosophers eat and think without sleeping, for a fixed time, at 5, 1,000 and 100,000 philosophers.
+ * A thread per philosopher is not possible at 100,000, so a fixed number of threads share them:
+ * every thread owns a contiguous block of philosophers and lets them eat in turn. A thread waits for
+ * one philosopher at a time, and a philosopher who is eating always belongs to a thread that is not waiting,
+ * so the threads cannot all be stuck. The message-passing table has no blocking pickUp, there a thread serves
+ * all the philosophers of its block in turn. For each table it reports:
+ * - the meals per second of all philosophers together
+ * - the fairness: the fewest meals of a philosopher divided by the most, 1 when all ate equally often
+ * - whether two neighbours were ever seen eating at the same time
+ *
+ * With the monitor every pickUp and putDown takes the one table mutex, however far apart the philosophers are.
+ * With the fine-grained table only the threads whose blocks are next to each other share locks,
+ * and with Chandy/Misra they only exchange messages, without any lock.
+ *
+ * Usage:
+ * ```bash
+ * ./SynchronizationMonitorBenchmark [milliseconds] [threads]
+ * ```
+ */
+
+/**
+ * The result of one run
+ */
+struct Result {
+    double mealsPerSecond;
+    double fairness;
+    bool correct;
+};
+
+/**
+ * Run a block of philosophers on a monitor table: one philosopher after the other picks up, eats and puts down
+ * @param table - The table
+ * @param first - The first philosopher of the block
+ * @param last - One past the last philosopher of the block
+ * @param stop - Set when the time is up
+ * @param eat - Called for every meal
+ */
+template<typename Table, typename Eat>
+void dine(Table &table, int first, int last, const std::atomic<bool> &stop, Eat eat) {
+    for (int i = first; !stop.load(std::memory_order_relaxed); i = i + 1 < last ? i + 1 : first) {
+        table.pickUp(i);
+        eat(i);
+        table.putDown(i);
+    }
+}
+
+/**
+ * Run a block of philosophers on the message-passing table: the thread serves all of them in turn,
+ * and each one becomes hungry as soon as it has eaten and eats as soon as it has both forks
+ * @param table - The table
+ * @param first - The first philosopher of the block
+ * @param last - One past the last philosopher of the block
+ * @param stop - Set when the time is up
+ * @param eat - Called for every meal
+ */
+template<typename Eat>
+void dine(ChandyMisraDiningPhilosophers &table, int first, int last, const std::atomic<bool> &stop, Eat eat) {
+    while (!stop.load(std::memory_order_relaxed)) {
+        bool ate = false;
+        for (int i = first; i < last; i++) {
+            table.serve(i);
+            if (table.isThinking(i)) {
+                table.becomeHungry(i);
+            }
+            if (table.tryEat(i)) {
+                eat(i);
+                table.finishEating(i);
+                ate = true;
+            }
+        }
+        if (!ate) {
+            // All of them wait for forks from the other threads
+            std::this_thread::yield();
+        }
+    }
+}
+
+/**
+ * Let the philosophers eat for a while
+ * @param philosophers - The number of philosophers
+ * @param threads - The number of threads, at most one per philosopher
+ * @param duration - How long they eat
+ * @return - The meals per second, the fairness and whether neighbours never ate together
+ */
+template<typename Table>
+Result run(int philosophers, int threads, std::chrono::milliseconds duration) {
+    Table table(philosophers);
+    std::unique_ptr<std::atomic<bool>[]> eating(new std::atomic<bool>[philosophers]);
+    for (int i = 0; i < philosophers; i++) {
+        eating[i].store(false);
+    }
+    std::atomic<bool> correct(true);
+    std::atomic<int> ready(0);
+    std::atomic<bool> start(false);
+    std::atomic<bool> stop(false);
+    std::vector<long long> meals(philosophers, 0);     // Each written by the thread of its philosopher
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            int first = int((long long) philosophers * t / threads);
+            int last = int((long long) philosophers * (t + 1) / threads);
+            ready++;
+            while (!start.load()) {
+                std::this_thread::yield();
+            }
+            dine(table, first, last, stop, [&](int i) {
+                eating[i].store(true, std::memory_order_relaxed);
+                if (eating[(i + philosophers - 1) % philosophers].load(std::memory_order_relaxed) ||
+                    eating[(i + 1) % philosophers].load(std::memory_order_relaxed)) {
+                    correct.store(false);
+                }
+                eating[i].store(false, std::memory_order_relaxed);
+                meals[i]++;
+            });
+        });
+    }
+    while (ready.load() < threads) {
+        std::this_thread::yield();
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true);
+    std::this_thread::sleep_for(duration);
+    stop.store(true);
+    for (auto &worker: workers) {
+        worker.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    long long total = 0;
+    for (long long count: meals) {
+        total += count;
+    }
+    auto extremes = std::minmax_element(meals.begin(), meals.end());
+    double fairness = *extremes.second > 0 ? double(*extremes.first) / double(*extremes.second) : 0;
+    return {double(total) / seconds, fairness, correct.load()};
+}
+
+/**
+ * Print the result of a table
+ * @param name - The name of the table
+ * @param result - The result
+ */
+void report(const char *name, const Result &result) {
+    std::cout << std::setw(16) << name << std::fixed << std::setprecision(0) << std::setw(16)
+              << result.mealsPerSecond << std::setprecision(3) << std::setw(12) << result.fairness << (result.correct ? "" : "  neighbours ate together") << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    std::chrono::milliseconds duration(argc > 1 ? std::atoi(argv[1]) : 500);
+    int threads = argc > 2 ? std::atoi(argv[2]) : std::max(4, int(std::thread::hardware_concurrency()));
+    if (duration.count() <= 0 || threads < 1) {
+        std::cout << "Usage: SynchronizationMonitorBenchmark [milliseconds] [threads]" << std::endl;
+        return 1;
+    }
+
+    std::cout << std::thread::hardware_concurrency() << " hardware thread(s), " << duration.count()
+              << " ms per run" << std::endl;
+    for (int philosophers: {5, 1000, 100000}) {
+        int used = std::min(threads, philosophers);
+        std::cout << philosophers << " philosophers, " << used << " threads" << std::endl;
+        std::cout << std::setw(16) << "table" << std::setw(16) << "meals/s" << std::setw(12) << "fairness"
+                  << std::endl;
+        report("monitor", run<DiningPhilosophers>(philosophers, used, duration));
+        report("fine-grained", run<FineGrainedDiningPhilosophers>(philosophers, used, duration));
+        report("chandy-misra", run<ChandyMisraDiningPhilosophers>(philosophers, used, duration));
+    }
+    return 0;
+}
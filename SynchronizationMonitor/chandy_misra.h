@@ -0,0 +1,221 @@
+#ifndef SYNCHRONIZATIONMONITOR_CHANDY_MISRA_H
+#define SYNCHRONIZATIONMONITOR_CHANDY_MISRA_H
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * Lock-free mailbox from one thread to another
+ *
+ * A ring of Capacity slots, with `tail` written only by the sending thread and `head` only by the receiving one.
+ * The sender publishes a message with a release store of `tail` after writing the slot,
+ * and the receiver frees the slot with a release store of `head` after reading it, so no lock is needed.
+ * @tparam T - The message
+ * @tparam Capacity - The number of slots, a power of two
+ */
+template<typename T, unsigned Capacity>
+class Mailbox {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "The capacity must be a power of two");
+
+    std::atomic<unsigned> head{0};
+    std::atomic<unsigned> tail{0};
+    T slots[Capacity];
+
+public:
+    /**
+     * Called by the sending thread only
+     * @param message - The message
+     * @return - False if the mailbox is full
+     */
+    bool send(T message) {
+        unsigned t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        slots[t & (Capacity - 1)] = message;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Called by the receiving thread only
+     * @param message - Receives the message
+     * @return - False if the mailbox is empty
+     */
+    bool receive(T &message) {
+        unsigned h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        message = slots[h & (Capacity - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+/**
+ * Dining philosophers by message passing (Chandy and Misra)
+ *
+ * There is no shared monitor. Every fork belongs to one of its two philosophers at a time and is passed
+ * between them as a message, together with a request token that a philosopher sends to ask for the fork:
+ * - A fork is clean or dirty. A philosopher who has eaten makes its forks dirty, and a fork is cleaned when it is sent.
+ * - A hungry philosopher sends the request token for every fork it does not have.
+ * - A philosopher receiving a request gives up the fork if it is dirty and it is not eating, and asks for it back
+ *   at once if it is hungry itself. A clean fork is kept until it has eaten, then the deferred request is answered.
+ * The dirty forks always point from a philosopher who has eaten more recently to one who has not,
+ * so the philosophers cannot wait in a cycle, and a hungry philosopher eats before a neighbour who has just eaten
+ * can eat again. At the start every fork is dirty at the even one of its two philosophers, which keeps this order
+ * acyclic too. Giving every fork to the lower index would also do, but then only philosopher 0 can eat first
+ * and the others follow one by one along the whole table.
+ *
+ * Each philosopher has a mailbox from each neighbour. Only the thread that runs a philosopher reads its mailboxes
+ * and its state, and only the thread that runs a neighbour sends to it, so every mailbox has one sending
+ * and one receiving thread. A fork and a request are the only messages between two neighbours, one each at most
+ * in flight in a direction, so a mailbox never fills up.
+ *
+ * A philosopher only answers its neighbours when its thread calls serve(), so a thread must keep serving
+ * a philosopher while it thinks or waits for forks. There is no blocking pickUp: the thread calls serve(),
+ * becomeHungry(), tryEat() and finishEating() from its own loop, and can run many philosophers that way.
+ */
+class ChandyMisraDiningPhilosophers {
+    enum State { THINKING, HUNGRY, EATING };
+    enum Message : unsigned char { REQUEST, FORK };
+    enum Side { LEFT = 0, RIGHT = 1 };
+
+    /**
+     * A philosopher, with the forks and request tokens it holds on its left and right side
+     */
+    struct alignas(64) Philosopher {
+        State state = THINKING;
+        bool fork[2] = {false, false};
+        bool dirty[2] = {false, false};
+        bool token[2] = {false, false};
+        Mailbox<Message, 4> inbox[2];      // From the left and from the right neighbour
+    };
+
+    int n;
+    std::vector<Philosopher> philosophers;
+
+    int neighbour(int i, int side) const { return side == LEFT ? (i + n - 1) % n : (i + 1) % n; }
+
+    /**
+     * Send a message to the neighbour on a side
+     */
+    void send(int i, int side, Message message) {
+        // The neighbour receives it on its other side
+        if (!philosophers[neighbour(i, side)].inbox[1 - side].send(message)) {
+            throw std::logic_error("More than a fork and a request in flight between two philosophers.");
+        }
+    }
+
+    /**
+     * Give the fork on a side to the neighbour who asked for it
+     */
+    void giveFork(int i, int side) {
+        Philosopher &p = philosophers[i];
+        p.fork[side] = false;
+        p.dirty[side] = false;
+        send(i, side, FORK);
+        if (p.state == HUNGRY) {
+            // Ask for it back
+            p.token[side] = false;
+            send(i, side, REQUEST);
+        }
+    }
+
+public:
+    explicit ChandyMisraDiningPhilosophers(int n) : n(n), philosophers(n) {
+        if (n < 2) {
+            throw std::invalid_argument("At least two philosophers are needed, one fork each.");
+        }
+        // The fork between i and i + 1 starts dirty at the even one (at i if both are, with an odd n),
+        // the request token at the other one
+        for (int i = 0; i < n; i++) {
+            int j = neighbour(i, RIGHT);
+            if (i % 2 == 0) {
+                philosophers[i].fork[RIGHT] = true;
+                philosophers[i].dirty[RIGHT] = true;
+                philosophers[j].token[LEFT] = true;
+            } else {
+                philosophers[j].fork[LEFT] = true;
+                philosophers[j].dirty[LEFT] = true;
+                philosophers[i].token[RIGHT] = true;
+            }
+        }
+    }
+
+    /**
+     * Handle the messages of a philosopher's neighbours
+     * @param i - The philosopher
+     */
+    void serve(int i) {
+        Philosopher &p = philosophers[i];
+        for (int side = LEFT; side <= RIGHT; side++) {
+            Message message;
+            while (p.inbox[side].receive(message)) {
+                if (message == FORK) {
+                    p.fork[side] = true;
+                    p.dirty[side] = false;
+                } else {
+                    p.token[side] = true;
+                    if (p.fork[side] && p.dirty[side] && p.state != EATING) {
+                        giveFork(i, side);
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * A thinking philosopher becomes hungry and asks for the forks it does not have
+     * @param i - The philosopher
+     */
+    void becomeHungry(int i) {
+        Philosopher &p = philosophers[i];
+        p.state = HUNGRY;
+        for (int side = LEFT; side <= RIGHT; side++) {
+            if (!p.fork[side] && p.token[side]) {
+                p.token[side] = false;
+                send(i, side, REQUEST);
+            }
+        }
+    }
+
+    /**
+     * @param i - The philosopher
+     * @return - Whether it is thinking
+     */
+    bool isThinking(int i) const { return philosophers[i].state == THINKING; }
+
+    /**
+     * Start eating if hungry and holding both forks
+     * @param i - The philosopher
+     * @return - True if it is eating now
+     */
+    bool tryEat(int i) {
+        Philosopher &p = philosophers[i];
+        if (p.state == HUNGRY && p.fork[LEFT] && p.fork[RIGHT]) {
+            p.state = EATING;
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * Stop eating, make the forks dirty and answer the requests that came in meanwhile
+     * @param i - The philosopher
+     */
+    void finishEating(int i) {
+        Philosopher &p = philosophers[i];
+        p.state = THINKING;
+        for (int side = LEFT; side <= RIGHT; side++) {
+            p.dirty[side] = true;
+            if (p.token[side]) {
+                giveFork(i, side);
+            }
+        }
+    }
+};
+
+#endif // SYNCHRONIZATIONMONITOR_CHANDY_MISRA_H
@@ -0,0 +1,191 @@
+#ifndef SYNCHRONIZATIONMONITOR_DINING_PHILOSOPHERS_H
+#define SYNCHRONIZATIONMONITOR_DINING_PHILOSOPHERS_H
+
+#include <array>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+/**
+ * Dining philosophers monitor
+ *
+ * n philosophers sit around a table with a fork between every two of them. A hungry philosopher may only eat
+ * when neither neighbour is eating, checked by test(i), and a philosopher who puts down the forks tests both
+ * neighbours, who may be waiting for exactly those forks. The monitor is one mutex for the whole table,
+ * so every pickUp and putDown of every philosopher is serialized on it.
+ */
+class DiningPhilosophers {
+    enum State { THINKING, HUNGRY, EATING };
+    int n;
+    std::vector<State> state;
+    std::vector<std::condition_variable> self;
+    std::mutex mtx;
+
+    int left(int i) const { return (i + n - 1) % n; }
+
+    int right(int i) const { return (i + 1) % n; }
+
+    void test(int i) {
+        if (state[left(i)] != EATING &&
+            state[i] == HUNGRY &&
+            state[right(i)] != EATING) {
+            state[i] = EATING;
+            self[i].notify_one();
+        }
+    }
+
+public:
+    explicit DiningPhilosophers(int n) : n(n), state(n, THINKING), self(n) {}
+
+    void pickUp(int i) {
+        std::unique_lock<std::mutex> lock(mtx);
+        state[i] = HUNGRY;
+        test(i);
+        while (state[i] != EATING) {
+            self[i].wait(lock);
+        }
+    }
+
+    void putDown(int i) {
+        std::unique_lock<std::mutex> lock(mtx);
+        state[i] = THINKING;
+        // Test left and right neighbors
+        test(left(i));
+        test(right(i));
+    }
+};
+
+/**
+ * Dining philosophers with a lock per philosopher
+ *
+ * The same states and tests as the monitor, but each philosopher's state and condition variable are guarded
+ * by a mutex of its own, in a cache line of its own. test(i) reads philosophers i - 1, i and i + 1,
+ * so it holds their three locks. putDown(i) tests both neighbours, which needs i - 2 to i + 2,
+ * but only a hungry neighbour can start eating: it first looks at the neighbours under the locks of i - 1 to i + 1,
+ * and only takes the wider range when one of them is hungry. A neighbour that is not hungry then
+ * becomes hungry later under the lock of i, and its own test sees that i is thinking.
+ * Philosophers further apart than that never take the same lock, or write the same cache line.
+ * The locks are always taken in increasing index order, so two philosophers whose ranges overlap cannot deadlock.
+ */
+class FineGrainedDiningPhilosophers {
+    enum State { THINKING, HUNGRY, EATING };
+
+    struct alignas(64) Seat {
+        std::mutex mtx;
+        std::condition_variable self;
+        State state = THINKING;
+    };
+
+    int n;
+    std::vector<Seat> seats;
+
+    int left(int i) const { return (i + n - 1) % n; }
+
+    int right(int i) const { return (i + 1) % n; }
+
+    /**
+     * The seats within a distance of a philosopher, in increasing order without duplicates
+     */
+    class Neighbourhood {
+        FineGrainedDiningPhilosophers &table;
+        std::array<int, 5> seats{};
+        int count = 0;
+
+    public:
+        /**
+         * Lock the seats
+         * @param table - The table
+         * @param i - The philosopher
+         * @param radius - The distance, 1 or 2
+         */
+        Neighbourhood(FineGrainedDiningPhilosophers &table, int i, int radius) : table(table) {
+            if (i - radius >= 0 && i + radius < table.n) {
+                // Away from the ends of the table the seats are already distinct and in order
+                for (int seat = i - radius; seat <= i + radius; seat++) {
+                    seats[count++] = seat;
+                }
+            } else {
+                // Insert each seat in order, the same seat comes up twice when the table is small
+                for (int d = -radius; d <= radius; d++) {
+                    int seat = ((i + d) % table.n + table.n) % table.n;
+                    int k = count;
+                    while (k > 0 && seats[k - 1] > seat) {
+                        k--;
+                    }
+                    if (k > 0 && seats[k - 1] == seat) {
+                        continue;
+                    }
+                    for (int j = count; j > k; j--) {
+                        seats[j] = seats[j - 1];
+                    }
+                    seats[k] = seat;
+                    count++;
+                }
+            }
+            for (int k = 0; k < count; k++) {
+                table.seats[seats[k]].mtx.lock();
+            }
+        }
+
+        ~Neighbourhood() { unlockExcept(-1); }
+
+        /**
+         * Unlock all seats but one, which stays locked after the neighbourhood is gone
+         * @param kept - The seat to keep locked, or -1
+         */
+        void unlockExcept(int kept) {
+            for (int k = count - 1; k >= 0; k--) {
+                if (seats[k] != kept) {
+                    table.seats[seats[k]].mtx.unlock();
+                }
+            }
+            count = 0;
+        }
+
+        Neighbourhood(const Neighbourhood &) = delete;
+        Neighbourhood &operator=(const Neighbourhood &) = delete;
+    };
+
+    /**
+     * The locks of i - 1, i and i + 1 must be held
+     */
+    void test(int i) {
+        if (seats[left(i)].state != EATING &&
+            seats[i].state == HUNGRY &&
+            seats[right(i)].state != EATING) {
+            seats[i].state = EATING;
+            seats[i].self.notify_one();
+        }
+    }
+
+public:
+    explicit FineGrainedDiningPhilosophers(int n) : n(n), seats(n) {}
+
+    void pickUp(int i) {
+        Neighbourhood neighbourhood(*this, i, 1);
+        seats[i].state = HUNGRY;
+        test(i);
+        // Wait with only the own lock, a neighbour's putDown takes it to let this philosopher eat
+        neighbourhood.unlockExcept(i);
+        std::unique_lock<std::mutex> lock(seats[i].mtx, std::adopt_lock);
+        while (seats[i].state != EATING) {
+            seats[i].self.wait(lock);
+        }
+    }
+
+    void putDown(int i) {
+        {
+            Neighbourhood neighbourhood(*this, i, 1);
+            seats[i].state = THINKING;
+            if (seats[left(i)].state != HUNGRY && seats[right(i)].state != HUNGRY) {
+                return;
+            }
+        }
+        // Test left and right neighbors, with the locks of their other neighbours too
+        Neighbourhood neighbourhood(*this, i, 2);
+        test(left(i));
+        test(right(i));
+    }
+};
+
+#endif // SYNCHRONIZATIONMONITOR_DINING_PHILOSOPHERS_H
@@ -3,77 +3,105 @@
 #include <mutex>
 #include <condition_variable>
 #include <vector>
+#include <cstdlib>
+#include <atomic>
+#include <string>
+
+#include "chandy_misra.h"
+#include "dining_philosophers.h"
 
 std::mutex printMutex;
 
-class DiningPhilosophers {
-    enum State { THINKING, HUNGRY, EATING };
-    std::vector<State> state;
-    std::vector<std::condition_variable> self;
-    std::mutex mtx;
-
-public:
-    explicit DiningPhilosophers(int n) : state(n, THINKING), self(n) {}
-
-    void pickUp(int i) {
-        std::unique_lock<std::mutex> lock(mtx);
-        state[i] = HUNGRY;
-        test(i);
-        while (state[i] != EATING) {
-            self[i].wait(lock);
-        }
-    }
+void philosopher(int id, DiningPhilosophers& table, int numEats = 3) {
+    for (int i = 0; i < numEats; i++) {
+        // Think
+        std::unique_lock<std::mutex> lock(printMutex);
+        std::cout << "Philosopher " << id << " is thinking.\n";
+        lock.unlock();
+
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        // End think
+
+        table.pickUp(id);
+
+        // Eat
+        lock.lock();
+        std::cout << "Philosopher " << id << " is eating.\n";
+        lock.unlock();
 
-    void putDown(int i) {
-        std::unique_lock<std::mutex> lock(mtx);
-        state[i] = THINKING;
-        // Test left and right neighbors
-        test((i + 4) % 5);
-        test((i + 1) % 5);
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        // End eat
+
+        table.putDown(id);
     }
+}
 
-    void test(int i) {
-        if (state[(i + 4) % 5] != EATING &&
-            state[i] == HUNGRY &&
-            state[(i + 1) % 5] != EATING) {
-            state[i] = EATING;
-            self[i].notify_one();
-        }
+/**
+ * Answer the neighbours' requests for forks for a while
+ */
+void serveFor(ChandyMisraDiningPhilosophers& table, int id, std::chrono::milliseconds duration) {
+    auto end = std::chrono::steady_clock::now() + duration;
+    while (std::chrono::steady_clock::now() < end) {
+        table.serve(id);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
-};
+}
 
-void philosopher(int id, DiningPhilosophers& table, int numEats = 3) {
+std::atomic<int> finishedPhilosophers(0);
+
+void chandyMisraPhilosopher(int id, ChandyMisraDiningPhilosophers& table, int numPhilosophers, int numEats = 3) {
     for (int i = 0; i < numEats; i++) {
         // Think
         std::unique_lock<std::mutex> lock(printMutex);
         std::cout << "Philosopher " << id << " is thinking.\n";
         lock.unlock();
 
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+        serveFor(table, id, std::chrono::seconds(1));
         // End think
 
-        table.pickUp(id);
+        // Ask the neighbours for the missing forks and wait for them
+        table.becomeHungry(id);
+        while (!table.tryEat(id)) {
+            serveFor(table, id, std::chrono::milliseconds(1));
+        }
 
         // Eat
         lock.lock();
         std::cout << "Philosopher " << id << " is eating.\n";
         lock.unlock();
 
+        // The requests that arrive meanwhile wait in the mailboxes
         std::this_thread::sleep_for(std::chrono::seconds(1));
         // End eat
 
-        table.putDown(id);
+        table.finishEating(id);
+    }
+
+    // The neighbours may still need the forks of this philosopher
+    finishedPhilosophers++;
+    while (finishedPhilosophers.load() < numPhilosophers) {
+        serveFor(table, id, std::chrono::milliseconds(1));
     }
 }
 
-int main() {
-    int numPhilosophers = 5;
+int main(int argc, char *argv[]) {
+    int numPhilosophers = argc > 1 ? std::atoi(argv[1]) : 5;
+    std::string mode = argc > 2 ? argv[2] : "monitor";
+    if (numPhilosophers < 2 || (mode != "monitor" && mode != "chandy-misra")) {
+        std::cout << "Usage: SynchronizationMonitor [philosophers, at least 2] [monitor|chandy-misra]" << std::endl;
+        return 1;
+    }
     DiningPhilosophers table(numPhilosophers);
+    ChandyMisraDiningPhilosophers messageTable(numPhilosophers);
 
     std::vector<std::thread> philosophers;
     philosophers.reserve(numPhilosophers);
     for (int i = 0; i < numPhilosophers; i++) {
-        philosophers.emplace_back(philosopher, i, std::ref(table), 20);
+        if (mode == "monitor") {
+            philosophers.emplace_back(philosopher, i, std::ref(table), 20);
+        } else {
+            philosophers.emplace_back(chandyMisraPhilosopher, i, std::ref(messageTable), numPhilosophers, 20);
+        }
     }
 
     for (auto& p : philosophers) {
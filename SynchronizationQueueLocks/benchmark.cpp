@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "queue_locks.h"
+
+/**
+ * Lock benchmark
+ *
+ * Every thread repeatedly takes the lock, updates a few shared cache lines and releases it,
+ * for a fixed time, with 2, 4, 8, ... threads. For each lock it reports:
+ * - the acquisitions per second of all threads together, in millions
+ * - the fairness: the fewest acquisitions of a thread divided by the most, 1 when every thread got the same share
+ *
+ * test-and-set and compare-and-swap are the locks of SynchronizationTestAndSet and SynchronizationCompareAndSwap.
+ * On a machine with fewer cores than threads the queue locks can only hand over to a waiter that is running,
+ * so their numbers there measure the scheduler as much as the lock.
+ *
+ * Usage:
+ * ```bash
+ * ./SynchronizationQueueLocksBenchmark [milliseconds] [max threads]
+ * ```
+ */
+
+/**
+ * The data protected by the lock, a few cache lines written in every critical section
+ */
+struct alignas(64) SharedData {
+    long long counter = 0;
+    long long lines[4 * 8] = {};
+};
+
+/**
+ * The result of one run
+ */
+struct Result {
+    double acquisitionsPerSecond;
+    double fairness;
+    bool correct;
+};
+
+/**
+ * Let the threads hammer a lock for a while
+ * @param threads - The number of threads
+ * @param duration - How long they run
+ * @return - The throughput and fairness
+ */
+template<typename Lock>
+Result run(int threads, std::chrono::milliseconds duration) {
+    Lock lock;
+    SharedData data;
+    std::atomic<int> ready(0);
+    std::atomic<bool> start(false);
+    std::atomic<bool> stop(false);
+    std::vector<long long> counts(threads, 0);
+
+    std::vector<std::thread> workers;
+    for (int id = 0; id < threads; id++) {
+        workers.emplace_back([&, id] {
+            typename Lock::Handle handle(lock);
+            long long count = 0;
+            ready++;
+            while (!start.load()) {
+                std::this_thread::yield();
+            }
+            while (!stop.load(std::memory_order_relaxed)) {
+                lock.lock(handle);
+                data.counter++;
+                for (int line = 0; line < 4; line++) {
+                    data.lines[8 * line]++;
+                }
+                lock.unlock(handle);
+                count++;
+                // A little work outside of the lock, so the holder is not always the thread that released it
+                for (int i = 0; i < 16; i++) {
+                    spinPause();
+                }
+            }
+            counts[id] = count;
+        });
+    }
+    while (ready.load() < threads) {
+        std::this_thread::yield();
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true);
+    std::this_thread::sleep_for(duration);
+    stop.store(true);
+    for (auto &worker: workers) {
+        worker.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    long long total = 0;
+    for (long long count: counts) {
+        total += count;
+    }
+    auto extremes = std::minmax_element(counts.begin(), counts.end());
+    Result result;
+    result.acquisitionsPerSecond = double(total) / std::chrono::duration<double>(end - begin).count();
+    result.fairness = *extremes.second > 0 ? double(*extremes.first) / double(*extremes.second) : 0;
+    result.correct = data.counter == total && data.lines[8 * 3] == total;
+    return result;
+}
+
+/**
+ * Print the result of a lock
+ * @param name - The name of the lock
+ * @param result - The result
+ */
+void report(const char *name, const Result &result) {
+    std::cout << std::setw(18) << name << std::fixed << std::setprecision(2) << std::setw(16)
+              << result.acquisitionsPerSecond / 1e6 << std::setw(12) << result.fairness
+              << (result.correct ? "" : "  lost updates") << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    std::chrono::milliseconds duration(argc > 1 ? std::atoi(argv[1]) : 500);
+    int maxThreads = argc > 2 ? std::atoi(argv[2]) : 64;
+
+    std::cout << std::thread::hardware_concurrency() << " hardware thread(s), " << duration.count()
+              << " ms per run" << std::endl;
+    for (int threads = 2; threads <= maxThreads; threads *= 2) {
+        std::cout << threads << " threads" << std::endl;
+        std::cout << std::setw(18) << "lock" << std::setw(16) << "Macq/s" << std::setw(12) << "fairness"
+                  << std::endl;
+        report("test-and-set", run<TestAndSetLock>(threads, duration));
+        report("compare-and-swap", run<CompareAndSwapLock>(threads, duration));
+        report("MCS", run<MCSLock>(threads, duration));
+        report("CLH", run<CLHLock>(threads, duration));
+    }
+    return 0;
+}
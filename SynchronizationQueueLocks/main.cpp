@@ -0,0 +1,89 @@
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <vector>
+
+#include "queue_locks.h"
+
+/**
+ * The test-and-set and compare-and-swap locks make all waiters spin on one shared flag.
+ * The MCS and CLH queue locks give each waiter its own flag and hand the lock over in arrival order (see queue_locks.h).
+ */
+MCSLock mcs;
+CLHLock clh;
+
+/**
+ * The function is used to acquire the MCS lock.
+ *
+ * @param critical_section - The critical section to be executed.
+ * @param id - The id of the thread.
+ */
+void acquire_mcs(void (*critical_section)(int), int id) {
+    // One handle per thread, created on its first acquisition and kept until the thread ends
+    thread_local MCSLock::Handle handle(mcs);
+    acquire(mcs, handle, critical_section, id);
+}
+
+/**
+ * The function is used to acquire the CLH lock.
+ *
+ * @param critical_section - The critical section to be executed.
+ * @param id - The id of the thread.
+ */
+void acquire_clh(void (*critical_section)(int), int id) {
+    // One handle per thread, created on its first acquisition and kept until the thread ends
+    thread_local CLHLock::Handle handle(clh);
+    acquire(clh, handle, critical_section, id);
+}
+
+/**
+ * The function is used to execute the critical section.
+ *
+ * @param id - The id of the thread.
+ */
+void critical_section(int id) {
+    for (int i = 0; i < 3; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        std::cout << "Delay " << (i + 1) * 200 << " millisecond(s)." << " Thread id: " << id << std::endl;
+    }
+
+    std::cout << "Critical section is executed." << " Thread id: " << id << std::endl;
+}
+
+int main() {
+    const int num_threads = 3;
+
+    std::cout << "MCS lock:" << std::endl;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; i++) {
+        threads.emplace_back(acquire_mcs, critical_section, i);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    std::cout << "CLH lock:" << std::endl;
+    threads.clear();
+    for (int i = 0; i < num_threads; i++) {
+        threads.emplace_back(acquire_clh, critical_section, i);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    return 0;
+}
+
+/**
+ * 以上程式碼中，每個等待的執行緒都在自己的節點上自旋，而不是在同一個 atomic<bool> 上。
+ * - Mutual exclusion is preserved 互斥執行
+ *   - 只有前一個持有者清除的那個旗標會讓下一個執行緒進入。
+ * - Progress requirement is satisfied 在沒人執行時可以直接進入
+ *   - 佇列為空時，tail 的 exchange 立即成功。
+ * - Bounded waiting requirement is satisfied 有界等待
+ *   - 執行緒依照 exchange tail 的順序 (FIFO) 取得鎖，前面最多只有 n - 1 個執行緒。
+ *
+ * 與 test-and-set 相比，釋放鎖時只寫入下一個執行緒的旗標，快取行只需要移動一次，
+ * 不會因為所有等待者同時寫同一個變數而在核心之間來回搬移。
+ * 效能比較請執行 SynchronizationQueueLocksBenchmark。
+ */
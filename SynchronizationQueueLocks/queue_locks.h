@@ -0,0 +1,263 @@
+#ifndef SYNCHRONIZATIONQUEUELOCKS_QUEUE_LOCKS_H
+#define SYNCHRONIZATIONQUEUELOCKS_QUEUE_LOCKS_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+/**
+ * Spin locks with one shared flag and queue locks with one flag per waiter
+ *
+ * The test-and-set and compare-and-swap locks of SynchronizationTestAndSet and SynchronizationCompareAndSwap
+ * make every waiter write the same `std::atomic<bool>`. Each failed exchange takes the cache line exclusively,
+ * so under contention the line bounces between all cores and the holder's release has to queue up behind them.
+ *
+ * The queue locks make every waiter spin on a flag in its own cache line, and the releasing thread writes
+ * only the flag of the next waiter: one cache line transfer per hand-over, whatever the number of waiters.
+ * The waiters are served in the order they arrived (FIFO), which also gives bounded waiting.
+ *
+ * - MCS (Mellor-Crummey and Scott): the waiters form a linked list, each one spins on the flag of its own node
+ *   and the holder follows its `next` pointer to hand the lock over.
+ * - CLH (Craig, Landin and Hagersten): each waiter spins on the flag of its predecessor's node.
+ *   The list is implicit, a release is a single store, and the waiter keeps its predecessor's node for the next time.
+ *
+ * Every lock has a `Handle`, the per-thread state it needs (a queue node, or nothing for the spin locks):
+ * ```cpp
+ * MCSLock::Handle handle(lock);
+ * lock.lock(handle);
+ * // critical section
+ * lock.unlock(handle);
+ * ```
+ */
+
+/**
+ * Tell the processor that the thread is spinning
+ * This frees resources for a hyper-threaded sibling and avoids a memory-order mis-speculation when the flag changes.
+ */
+inline void spinPause() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield");
+#endif
+}
+
+/**
+ * Wait until a condition holds, spinning for a while and then yielding the processor
+ * A queue lock hands over to one particular thread: when there are more threads than cores and that thread
+ * is not running, spinning would only keep it from running, so the waiter gives up its time slice.
+ *
+ * @param ready - The condition
+ */
+template<typename Ready>
+void spinUntil(Ready ready) {
+    for (int spins = 0; !ready(); spins++) {
+        if (spins < 128) {
+            spinPause();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+/**
+ * The lock of SynchronizationTestAndSet: exchange the shared flag, yield when it was taken
+ */
+class TestAndSetLock {
+    std::atomic<bool> flag{false};
+
+public:
+    struct Handle {
+        explicit Handle(TestAndSetLock &) {}
+    };
+
+    void lock(Handle &) {
+        while (flag.exchange(true, std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+    }
+
+    void unlock(Handle &) { flag.store(false, std::memory_order_release); }
+};
+
+/**
+ * The lock of SynchronizationCompareAndSwap: compare-and-swap the shared flag, yield when it was taken
+ */
+class CompareAndSwapLock {
+    std::atomic<bool> flag{false};
+
+public:
+    struct Handle {
+        explicit Handle(CompareAndSwapLock &) {}
+    };
+
+    void lock(Handle &) {
+        bool expected = false;
+        while (!flag.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            expected = false;
+            std::this_thread::yield();
+        }
+    }
+
+    void unlock(Handle &) { flag.store(false, std::memory_order_release); }
+};
+
+/**
+ * A queue node of the MCS lock, alone in its cache line so that its waiter is the only thread reading it
+ */
+struct alignas(64) MCSNode {
+    std::atomic<MCSNode *> next{nullptr};
+    std::atomic<bool> locked{false};
+};
+
+/**
+ * MCS queue lock
+ * `tail` is the last waiter. A thread appends its node with one exchange, links it behind its predecessor
+ * and spins on its own `locked` flag until the predecessor clears it.
+ */
+class MCSLock {
+    alignas(64) std::atomic<MCSNode *> tail{nullptr};
+
+public:
+    /**
+     * The node of a thread, it lives on the thread's stack while the thread holds or waits for the lock
+     */
+    struct Handle {
+        MCSNode node;
+
+        explicit Handle(MCSLock &) {}
+    };
+
+    void lock(Handle &handle) {
+        MCSNode &node = handle.node;
+        node.next.store(nullptr, std::memory_order_relaxed);
+        node.locked.store(true, std::memory_order_relaxed);
+        MCSNode *predecessor = tail.exchange(&node, std::memory_order_acq_rel);
+        if (predecessor == nullptr) {
+            return;
+        }
+        predecessor->next.store(&node, std::memory_order_release);
+        spinUntil([&node] { return !node.locked.load(std::memory_order_acquire); });
+    }
+
+    void unlock(Handle &handle) {
+        MCSNode &node = handle.node;
+        MCSNode *successor = node.next.load(std::memory_order_acquire);
+        if (successor == nullptr) {
+            // No one is waiting, unless a thread has swapped itself into the tail but not linked its node yet
+            MCSNode *expected = &node;
+            if (tail.compare_exchange_strong(expected, nullptr, std::memory_order_release,
+                                             std::memory_order_relaxed)) {
+                return;
+            }
+            spinUntil([&] { return (successor = node.next.load(std::memory_order_acquire)) != nullptr; });
+        }
+        successor->locked.store(false, std::memory_order_release);
+    }
+};
+
+/**
+ * A queue node of the CLH lock, `locked` is true while its owner holds or waits for the lock
+ */
+struct alignas(64) CLHNode {
+    std::atomic<bool> locked{false};
+};
+
+/**
+ * CLH queue lock
+ * `tail` is the node of the last waiter, or a released node. A thread sets its node's flag, swaps it into the tail
+ * and spins on the node it got back. Releasing clears the flag of its own node, which its successor is watching.
+ *
+ * The predecessor's node is no longer used by anyone once the lock is acquired, so the thread takes it over
+ * for its next acquisition. The nodes therefore move between threads, and the lock owns them all.
+ */
+class CLHLock {
+    alignas(64) std::atomic<CLHNode *> tail;
+    std::mutex nodesMutex;
+    std::vector<std::unique_ptr<CLHNode>> nodes;
+    std::vector<CLHNode *> freeNodes;
+
+    CLHNode *takeNode() {
+        std::lock_guard<std::mutex> guard(nodesMutex);
+        if (freeNodes.empty()) {
+            nodes.emplace_back(new CLHNode);
+            return nodes.back().get();
+        }
+        CLHNode *node = freeNodes.back();
+        freeNodes.pop_back();
+        return node;
+    }
+
+    void returnNode(CLHNode *node) {
+        std::lock_guard<std::mutex> guard(nodesMutex);
+        freeNodes.push_back(node);
+    }
+
+public:
+    CLHLock() {
+        nodes.emplace_back(new CLHNode);
+        tail.store(nodes.back().get());
+    }
+
+    CLHLock(const CLHLock &) = delete;
+    CLHLock &operator=(const CLHLock &) = delete;
+
+    /**
+     * The node a thread enqueues next and the predecessor it waits on
+     * Keep a handle for many acquisitions, getting one takes a mutex.
+     */
+    class Handle {
+        CLHLock &owner;
+        CLHNode *node;
+        CLHNode *predecessor = nullptr;
+        friend class CLHLock;
+
+    public:
+        explicit Handle(CLHLock &lock) : owner(lock), node(lock.takeNode()) {}
+
+        ~Handle() { owner.returnNode(node); }
+
+        Handle(const Handle &) = delete;
+        Handle &operator=(const Handle &) = delete;
+    };
+
+    void lock(Handle &handle) {
+        handle.node->locked.store(true, std::memory_order_relaxed);
+        handle.predecessor = tail.exchange(handle.node, std::memory_order_acq_rel);
+        CLHNode *predecessor = handle.predecessor;
+        spinUntil([predecessor] { return !predecessor->locked.load(std::memory_order_acquire); });
+    }
+
+    void unlock(Handle &handle) {
+        CLHNode *node = handle.node;
+        handle.node = handle.predecessor;
+        node->locked.store(false, std::memory_order_release);
+    }
+};
+
+/**
+ * Run a critical section under a lock, in the shape of the acquire functions of the other projects
+ * The caller keeps the handle for all acquisitions of its thread, so that no acquisition takes the node mutex.
+ * @param lock - The lock
+ * @param handle - The handle of the calling thread for this lock
+ * @param critical_section - The critical section to be executed
+ * @param id - The id of the thread
+ */
+template<typename Lock>
+void acquire(Lock &lock, typename Lock::Handle &handle, void (*critical_section)(int), int id) {
+    lock.lock(handle);
+
+    // Critical section
+    critical_section(id);
+
+    // Release the lock
+    lock.unlock(handle);
+}
+
+#endif // SYNCHRONIZATIONQUEUELOCKS_QUEUE_LOCKS_H
@@ -0,0 +1,405 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include "read_mostly.h"
+#include "rw_locks.h"
+
+/**
+ * Reader-writer lock benchmark
+ *
+ * n threads repeatedly read a small shared record, a few cache lines, under the lock, for a fixed time,
+ * with n = 1, 2, 4, ... Each operation is a write instead with the given probability, which updates every field.
+ * For each lock it reports:
+ * - the reads per second of all threads together, in millions, which should grow with the cores for a scalable lock
+ * - the writes per second
+ * - the 99th percentile and the longest time a writer waited for the lock, in microseconds,
+ *   which grows without bound for a lock that lets the readers starve the writers
+ * - whether every read saw a consistent record, i.e. all fields equal
+ *
+ * first readers-writers is the design of SynchronizationFirstReaderWriterProblem, distributed the lock with
+ * per-thread reader indicators and phase-fair the lock that alternates reader and writer phases.
+ * With fewer cores than threads the read throughput cannot grow any further.
+ *
+ * A second table compares the read paths for read-mostly data: n threads only read while one writer thread
+ * updates the record every `write interval` microseconds. The read cost is the CPU time of the process
+ * divided by the reads, in nanoseconds, so threads waiting for each other on fewer cores count too.
+ * The locks take lock_shared for every read, the sequence lock copies the record and retries,
+ * and the RCU readers read the current copy and report a quiescent state every 64 reads.
+ *
+ * Usage:
+ * ```bash
+ * ./SynchronizationReaderWriterLocksBenchmark [milliseconds] [max threads] [write percent] [write interval]
+ * ```
+ */
+
+/**
+ * The data protected by the lock
+ */
+struct alignas(64) Record {
+    long long fields[16] = {};
+};
+
+/**
+ * @param record - A record
+ * @return - Whether all its fields are equal, i.e. no write was seen half done
+ */
+bool isConsistent(const Record &record) {
+    bool consistent = true;
+    for (long long field: record.fields) {
+        consistent &= field == record.fields[0];
+    }
+    return consistent;
+}
+
+/**
+ * @param record - The record to write
+ */
+void increment(Record &record) {
+    for (long long &field: record.fields) {
+        field++;
+    }
+}
+
+/**
+ * The result of one run
+ */
+struct Result {
+    double readsPerSecond;
+    double writesPerSecond;
+    double writeWaitP99;
+    double writeWaitMax;
+    bool consistent;
+};
+
+/**
+ * Let the threads read and write under a lock for a while
+ * @param threads - The number of threads
+ * @param duration - How long they run
+ * @param writesPerMillion - The share of the operations that are writes, per million
+ * @return - The throughput and the consistency
+ */
+template<typename Lock>
+Result run(int threads, std::chrono::milliseconds duration, unsigned writesPerMillion) {
+    Lock lock;
+    Record record;
+    std::atomic<int> ready(0);
+    std::atomic<bool> start(false);
+    std::atomic<bool> stop(false);
+    std::atomic<bool> consistent(true);
+    std::vector<long long> reads(threads, 0);
+    std::vector<long long> writes(threads, 0);
+    std::vector<std::vector<double>> writeWaits(threads);
+
+    std::vector<std::thread> workers;
+    for (int id = 0; id < threads; id++) {
+        workers.emplace_back([&, id] {
+            long long readCount = 0;
+            long long writeCount = 0;
+            std::vector<double> &waits = writeWaits[id];
+            bool torn = false;
+            std::uint32_t random = 2463534242u + id * 2654435761u;
+            ready++;
+            while (!start.load()) {
+                std::this_thread::yield();
+            }
+            while (!stop.load(std::memory_order_relaxed)) {
+                // xorshift32
+                random ^= random << 13;
+                random ^= random >> 17;
+                random ^= random << 5;
+                if (random % 1000000 < writesPerMillion) {
+                    auto requested = std::chrono::steady_clock::now();
+                    lock.lock();
+                    waits.push_back(std::chrono::duration<double, std::micro>(
+                            std::chrono::steady_clock::now() - requested).count());
+                    increment(record);
+                    lock.unlock();
+                    writeCount++;
+                } else {
+                    lock.lock_shared();
+                    long long first = record.fields[0];
+                    for (long long field: record.fields) {
+                        torn |= field != first;
+                    }
+                    lock.unlock_shared();
+                    readCount++;
+                }
+            }
+            reads[id] = readCount;
+            writes[id] = writeCount;
+            if (torn) {
+                consistent.store(false);
+            }
+        });
+    }
+    while (ready.load() < threads) {
+        std::this_thread::yield();
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true);
+    std::this_thread::sleep_for(duration);
+    stop.store(true);
+    for (auto &worker: workers) {
+        worker.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    long long totalReads = 0;
+    long long totalWrites = 0;
+    for (int id = 0; id < threads; id++) {
+        totalReads += reads[id];
+        totalWrites += writes[id];
+    }
+    Result result;
+    result.readsPerSecond = double(totalReads) / seconds;
+    result.writesPerSecond = double(totalWrites) / seconds;
+    result.consistent = consistent.load() && record.fields[15] == totalWrites;
+
+    std::vector<double> all;
+    for (const auto &waits: writeWaits) {
+        all.insert(all.end(), waits.begin(), waits.end());
+    }
+    result.writeWaitP99 = 0;
+    result.writeWaitMax = 0;
+    if (!all.empty()) {
+        auto p99 = all.begin() + static_cast<std::ptrdiff_t>(0.99 * double(all.size() - 1));
+        std::nth_element(all.begin(), p99, all.end());
+        result.writeWaitP99 = *p99;
+        result.writeWaitMax = *std::max_element(all.begin(), all.end());
+    }
+    return result;
+}
+
+/**
+ * The record under a reader-writer lock
+ */
+template<typename Lock>
+struct LockedRecord {
+    Lock lock;
+    Record record;
+
+    struct Reader {
+        LockedRecord &shared;
+
+        explicit Reader(LockedRecord &shared) : shared(shared) {}
+
+        /**
+         * @return - Whether the record read was consistent
+         */
+        bool read() {
+            shared.lock.lock_shared();
+            bool consistent = isConsistent(shared.record);
+            shared.lock.unlock_shared();
+            return consistent;
+        }
+    };
+
+    void write() {
+        lock.lock();
+        increment(record);
+        lock.unlock();
+    }
+};
+
+/**
+ * The record under a sequence lock
+ */
+struct SeqLockRecord {
+    SeqLock<Record> record;
+
+    struct Reader {
+        SeqLockRecord &shared;
+
+        explicit Reader(SeqLockRecord &shared) : shared(shared) {}
+
+        bool read() { return isConsistent(shared.record.read()); }
+    };
+
+    void write() { record.update(increment); }
+};
+
+/**
+ * The record in an RCU cell
+ */
+struct RcuRecord {
+    RcuCell<Record> cell{std::unique_ptr<Record>(new Record())};
+
+    struct Reader {
+        RcuCell<Record>::Reader reader;
+        int reads = 0;
+
+        explicit Reader(RcuRecord &shared) : reader(shared.cell) {}
+
+        bool read() {
+            bool consistent = isConsistent(*reader.read());
+            if (++reads % 64 == 0) {
+                reader.quiescent();
+            }
+            return consistent;
+        }
+    };
+
+    void write() { cell.update(increment); }
+};
+
+/**
+ * The result of a read-mostly run
+ */
+struct ReadResult {
+    double nanosecondsPerRead;
+    double readsPerSecond;
+    double writesPerSecond;
+    bool consistent;
+};
+
+/**
+ * Let the threads read while one writer updates the record at a fixed interval
+ * @param threads - The number of reader threads
+ * @param duration - How long they run
+ * @param writeInterval - The time between two writes
+ * @return - The read cost and throughput
+ */
+template<typename Shared>
+ReadResult runReadMostly(int threads, std::chrono::milliseconds duration, std::chrono::microseconds writeInterval) {
+    Shared shared;
+    std::atomic<int> ready(0);
+    std::atomic<bool> start(false);
+    std::atomic<bool> stop(false);
+    std::atomic<bool> consistent(true);
+    std::vector<long long> reads(threads, 0);
+    long long writes = 0;
+
+    std::vector<std::thread> workers;
+    for (int id = 0; id < threads; id++) {
+        workers.emplace_back([&, id] {
+            typename Shared::Reader reader(shared);
+            long long count = 0;
+            bool allConsistent = true;
+            ready++;
+            while (!start.load()) {
+                std::this_thread::yield();
+            }
+            while (!stop.load(std::memory_order_relaxed)) {
+                allConsistent &= reader.read();
+                count++;
+            }
+            reads[id] = count;
+            if (!allConsistent) {
+                consistent.store(false);
+            }
+        });
+    }
+    std::thread writer([&] {
+        while (!start.load()) {
+            std::this_thread::yield();
+        }
+        while (!stop.load(std::memory_order_relaxed)) {
+            shared.write();
+            writes++;
+            std::this_thread::sleep_for(writeInterval);
+        }
+    });
+    while (ready.load() < threads) {
+        std::this_thread::yield();
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    std::clock_t cpuBegin = std::clock();
+    start.store(true);
+    std::this_thread::sleep_for(duration);
+    stop.store(true);
+    for (auto &worker: workers) {
+        worker.join();
+    }
+    writer.join();
+    std::clock_t cpuEnd = std::clock();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    long long totalReads = 0;
+    for (long long count: reads) {
+        totalReads += count;
+    }
+    ReadResult result;
+    result.nanosecondsPerRead = totalReads > 0 ? double(cpuEnd - cpuBegin) / CLOCKS_PER_SEC / double(totalReads) * 1e9 : 0;
+    result.readsPerSecond = double(totalReads) / seconds;
+    result.writesPerSecond = double(writes) / seconds;
+    result.consistent = consistent.load();
+    return result;
+}
+
+/**
+ * Print the result of a read path
+ * @param name - The name of the read path
+ * @param result - The result
+ */
+void reportRead(const char *name, const ReadResult &result) {
+    std::cout << std::setw(24) << name << std::fixed << std::setprecision(1) << std::setw(12)
+              << result.nanosecondsPerRead << std::setprecision(2) << std::setw(12) << result.readsPerSecond / 1e6
+              << std::setprecision(0) << std::setw(12) << result.writesPerSecond
+              << (result.consistent ? "" : "  inconsistent") << std::endl;
+}
+
+/**
+ * Print the result of a lock
+ * @param name - The name of the lock
+ * @param result - The result
+ */
+void report(const char *name, const Result &result) {
+    std::cout << std::setw(24) << name << std::fixed << std::setprecision(2) << std::setw(12)
+              << result.readsPerSecond / 1e6 << std::setprecision(0) << std::setw(12) << result.writesPerSecond
+              << std::setprecision(1) << std::setw(14) << result.writeWaitP99 << std::setw(14) << result.writeWaitMax
+              << (result.consistent ? "" : "  inconsistent") << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    std::chrono::milliseconds duration(argc > 1 ? std::atoi(argv[1]) : 500);
+    int maxThreads = argc > 2 ? std::atoi(argv[2]) : 2 * std::max(1, int(std::thread::hardware_concurrency()));
+    double writePercent = argc > 3 ? std::atof(argv[3]) : 0.1;
+    std::chrono::microseconds writeInterval(argc > 4 ? std::atoi(argv[4]) : 100);
+    if (duration.count() <= 0 || maxThreads < 1 || writePercent < 0 || writePercent > 100 ||
+        writeInterval.count() < 0) {
+        std::cout << "Usage: SynchronizationReaderWriterLocksBenchmark [milliseconds] [max threads] [write percent]"
+                     " [write interval]" << std::endl;
+        return 1;
+    }
+    auto writesPerMillion = static_cast<unsigned>(writePercent * 10000);
+
+    std::cout << std::thread::hardware_concurrency() << " hardware thread(s), " << duration.count()
+              << " ms per run, " << writePercent << "% writes" << std::endl;
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        std::cout << "n = " << threads << std::endl;
+        std::cout << std::setw(24) << "lock" << std::setw(12) << "Mreads/s" << std::setw(12) << "writes/s"
+                  << std::setw(14) << "write p99 us" << std::setw(14) << "write max us"
+                  << std::endl;
+        report("first readers-writers", run<FirstReadersWritersLock>(threads, duration, writesPerMillion));
+        report("std::shared_mutex", run<std::shared_mutex>(threads, duration, writesPerMillion));
+        report("distributed", run<DistributedReaderWriterLock>(threads, duration, writesPerMillion));
+        report("phase-fair", run<PhaseFairReaderWriterLock>(threads, duration, writesPerMillion));
+    }
+
+    std::cout << "Read-mostly, one write every " << writeInterval.count() << " us" << std::endl;
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        std::cout << "n = " << threads << std::endl;
+        std::cout << std::setw(24) << "read path" << std::setw(12) << "ns/read" << std::setw(12) << "Mreads/s"
+                  << std::setw(12) << "writes/s" << std::endl;
+        reportRead("first readers-writers",
+                   runReadMostly<LockedRecord<FirstReadersWritersLock>>(threads, duration, writeInterval));
+        reportRead("std::shared_mutex", runReadMostly<LockedRecord<std::shared_mutex>>(threads, duration, writeInterval));
+        reportRead("distributed",
+                   runReadMostly<LockedRecord<DistributedReaderWriterLock>>(threads, duration, writeInterval));
+        reportRead("phase-fair", runReadMostly<LockedRecord<PhaseFairReaderWriterLock>>(threads, duration, writeInterval));
+        reportRead("seqlock", runReadMostly<SeqLockRecord>(threads, duration, writeInterval));
+        reportRead("rcu", runReadMostly<RcuRecord>(threads, duration, writeInterval));
+    }
+    return 0;
+}
@@ -0,0 +1,204 @@
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <sstream>
+#include <chrono>
+#include <string>
+
+#include "read_mostly.h"
+#include "rw_locks.h"
+
+DistributedReaderWriterLock distributed_lock;
+PhaseFairReaderWriterLock phase_fair_lock;
+
+std::mutex log_mutex;                 // A mutex for protecting the log
+std::vector<std::string> log_entries; // Vector to hold log entries
+
+/**
+ * @brief Logs a message with a start and end timestamp.
+ * @param id - Thread identifier
+ * @param role - "Reader" or "Writer"
+ * @param start_time - Start time of the operation
+ * @param end_time - End time of the operation
+ */
+void log(int id, const std::string& role, std::chrono::milliseconds start_time, std::chrono::milliseconds end_time) {
+    std::stringstream ss;
+    ss << role << " " << id << " started at " << start_time.count() << "ms and ended at " << end_time.count() << "ms.";
+
+    std::lock_guard<std::mutex> guard(log_mutex);
+    log_entries.push_back(ss.str());
+}
+
+/**
+ * @brief Access the resource for a while and log it
+ * @param id - Thread identifier
+ * @param role - "Reader" or "Writer"
+ */
+void access(int id, const std::string& role) {
+    auto start_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch());
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    auto end_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch());
+
+    log(id, role, start_time, end_time);
+}
+
+/**
+ * @brief Reader function
+ * @param lock - The reader-writer lock
+ * @param id - Reader id
+ */
+template<typename Lock>
+void reader(Lock& lock, int id) {
+    /**
+     * The distributed lock counts this reader in its own slot, no reader count shared by all readers.
+     * The phase-fair lock lets it in at once unless a writer is waiting, then after that one writer.
+     */
+    lock.lock_shared();
+    access(id, "Reader");
+    lock.unlock_shared();
+}
+
+/**
+ * Writer function
+ * @param lock - The reader-writer lock
+ * @param id - Writer id
+ */
+template<typename Lock>
+void writer(Lock& lock, int id) {
+    /**
+     * Block new readers and wait until the readers already in have left.
+     */
+    lock.lock();
+    access(id, "Writer");
+    lock.unlock();
+}
+
+/**
+ * Start readers and writers on a lock, a writer between every two readers, and print the log
+ * @param lock - The reader-writer lock
+ */
+template<typename Lock>
+void run(Lock& lock) {
+    std::vector<std::thread> threads;
+
+    threads.reserve(7);
+    for (int i = 0; i < 7; i++) {
+        if (i % 3 == 2) {
+            threads.emplace_back(writer<Lock>, std::ref(lock), i / 3);
+        } else {
+            threads.emplace_back(reader<Lock>, std::ref(lock), i - i / 3);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));  // Arrive in order
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // Print all log entries
+    for (const auto& entry : log_entries) {
+        std::cout << entry << std::endl;
+    }
+    log_entries.clear();
+}
+
+/**
+ * A small record for the sequence lock
+ */
+struct Position {
+    int x;
+    int y;
+};
+
+SeqLock<Position> position(Position{0, 0});
+RcuCell<std::string> greeting(std::unique_ptr<std::string>(new std::string("Hello")));
+
+/**
+ * Read the shared data a few times without taking any lock
+ * @param id - Reader id
+ */
+void lock_free_reader(int id) {
+    RcuCell<std::string>::Reader rcu_reader(greeting);
+    for (int i = 0; i < 3; i++) {
+        Position seen = position.read();
+        std::stringstream ss;
+        ss << "Reader " << id << " sees (" << seen.x << ", " << seen.y << ") and \"" << *rcu_reader.read() << "\".";
+        rcu_reader.quiescent();   // Holds no pointer from greeting any more
+
+        {
+            std::lock_guard<std::mutex> guard(log_mutex);
+            log_entries.push_back(ss.str());
+        }
+        // Sleep without the log mutex, so the readers never wait for each other
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+}
+
+/**
+ * Update the shared data: write the sequence lock, publish a new copy of the string
+ */
+void lock_free_writer() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    position.write(Position{1, 1});
+    greeting.update([](std::string& text) { text += ", world"; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    position.write(Position{2, 2});
+    greeting.update([](std::string& text) { text += "!"; });
+}
+
+int main() {
+    std::cout << "Distributed reader indicators:" << std::endl;
+    run(distributed_lock);
+
+    std::cout << "Phase-fair:" << std::endl;
+    run(phase_fair_lock);
+
+    std::cout << "Sequence lock and read-copy-update:" << std::endl;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 2; i++) {
+        threads.emplace_back(lock_free_reader, i);
+    }
+    threads.emplace_back(lock_free_writer);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& entry : log_entries) {
+        std::cout << entry << std::endl;
+    }
+
+    return 0;
+}
+
+/**
+ * 互斥執行:
+ * - 寫者先舉起 writer 旗標，再等待每個讀者槽位歸零；讀者先在自己的槽位加一，再檢查 writer 旗標。
+ * - 兩邊都是 sequentially consistent 的操作，因此至少有一方會看到另一方：
+ *   讀者看到旗標就退出槽位等待，或是寫者看到讀者就等它離開，讀者與寫者不會同時進入。
+ * - 寫者之間以 writerMutex 互斥。
+ *
+ * 可擴展性:
+ * - SynchronizationFirstReaderWriterProblem 的每個讀者都要鎖兩次 reader_count_mutex 來更新同一個 reader_count，
+ *   這條快取行在所有核心之間搬移，讀取的吞吐量不會隨核心數增加。
+ * - 這裡每個執行緒在自己的快取行中計數，不同核心上的讀者不會寫到同一條快取行，代價轉移到很少發生的寫者身上。
+ *
+ * 補充:
+ * - 寫者等待時新的讀者會讓路，因此持續不斷的寫者可能讓讀者等待，這個鎖適合讀遠多於寫的資料。
+ *
+ * Phase-fair 有界等待:
+ * - SynchronizationFirstReaderWriterProblem 中，只要 reader_count 大於零新的讀者就能進入，
+ *   持續不斷的讀者會讓寫者永遠等待 (starvation)。
+ * - Phase-fair 鎖讓讀者階段與寫者階段輪流：寫者只等待它到達時已經在裡面的讀者，
+ *   寫者到達之後的讀者要等這一個寫者寫完才一起進入。
+ * - 因此寫者最多等待一個讀者階段 (加上排在它前面的寫者)，讀者最多等待一個寫者階段。
+ *   在示範中，讀者 2、3 在寫者 0 之後到達，會等寫者 0 寫完才讀取。
+ *
+ * 讀者不寫共享記憶體:
+ * - 上面的鎖在讀取時都要寫入共享的計數器、槽位或號碼牌，每次讀取至少一個 atomic read-modify-write。
+ * - Sequence lock：寫者寫入前後各把 sequence 加一 (寫入中為奇數)，讀者複製資料，
+ *   若前後讀到的 sequence 不同或為奇數就重讀，適合小型、可直接複製的資料。
+ * - Read-copy-update：寫者複製物件、修改副本，再以 atomic 指標交換發佈，讀者只讀取指標。
+ *   舊的物件要等每個讀者都回報過 quiescent state (不再持有舊指標) 之後才釋放 (延遲釋放)。
+ */
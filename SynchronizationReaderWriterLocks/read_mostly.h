@@ -0,0 +1,267 @@
+#ifndef SYNCHRONIZATIONREADERWRITERLOCKS_READ_MOSTLY_H
+#define SYNCHRONIZATIONREADERWRITERLOCKS_READ_MOSTLY_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "rw_locks.h"
+
+/**
+ * Read paths that do not write shared memory
+ *
+ * Every reader-writer lock in rw_locks.h writes on the read side: a shared counter, a slot or a ticket,
+ * so each read costs at least one atomic read-modify-write. For data that is read thousands of times
+ * for every write, the two classes here let the readers only load:
+ * - SeqLock<T>: small trivially copyable data. A reader copies it and retries if a writer was active meanwhile.
+ * - RcuCell<T>: larger objects. A writer publishes a new copy by swapping a pointer, and the old copy is freed
+ *   once every reader has stopped using it (read-copy-update).
+ */
+
+/**
+ * Sequence lock
+ *
+ * The writer makes `sequence` odd, writes the data and makes `sequence` even again.
+ * A reader loads `sequence`, copies the data and loads `sequence` again: if it was odd or has changed,
+ * a writer was active and the copy may be torn, so it tries again. A reader never makes a writer wait.
+ *
+ * The data is kept in relaxed atomic words, so a copy that races with a writer is a retried read,
+ * not a data race. The writers are serialized by a mutex.
+ * @tparam T - The data, trivially copyable
+ */
+template<typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "A sequence lock copies its data byte by byte");
+
+    static const std::size_t wordCount = (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+    alignas(64) std::atomic<unsigned> sequence{0};
+    std::atomic<std::uint64_t> words[wordCount];
+    std::mutex writerMutex;
+
+    void store(const T &value) {
+        std::uint64_t buffer[wordCount] = {};
+        std::memcpy(buffer, &value, sizeof(T));
+        for (std::size_t i = 0; i < wordCount; i++) {
+            words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+    }
+
+public:
+    explicit SeqLock(const T &value = T()) { store(value); }
+
+    SeqLock(const SeqLock &) = delete;
+    SeqLock &operator=(const SeqLock &) = delete;
+
+    /**
+     * @return - A consistent copy of the data
+     */
+    T read() const {
+        std::uint64_t buffer[wordCount];
+        SpinWait spin;
+        while (true) {
+            unsigned before = sequence.load(std::memory_order_acquire);
+            if ((before & 1) == 0) {
+                for (std::size_t i = 0; i < wordCount; i++) {
+                    buffer[i] = words[i].load(std::memory_order_relaxed);
+                }
+                // The copy must be complete before the second load of sequence
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sequence.load(std::memory_order_relaxed) == before) {
+                    break;
+                }
+            }
+            spin.wait();
+        }
+        T value;
+        std::memcpy(&value, buffer, sizeof(T));
+        return value;
+    }
+
+    /**
+     * @param value - The new data
+     */
+    void write(const T &value) {
+        std::lock_guard<std::mutex> guard(writerMutex);
+        unsigned current = sequence.load(std::memory_order_relaxed);
+        sequence.store(current + 1, std::memory_order_relaxed);
+        // The odd sequence must be visible before any of the new words
+        std::atomic_thread_fence(std::memory_order_release);
+        store(value);
+        sequence.store(current + 2, std::memory_order_release);
+    }
+
+    /**
+     * Change the data in place, atomically with respect to the other writers
+     * @param update - Called with a copy of the data to modify
+     */
+    template<typename Update>
+    void update(Update update) {
+        std::lock_guard<std::mutex> guard(writerMutex);
+        unsigned current = sequence.load(std::memory_order_relaxed);
+        // Only writers change the words, and this one holds the mutex, so they can be read without retrying
+        std::uint64_t buffer[wordCount];
+        for (std::size_t i = 0; i < wordCount; i++) {
+            buffer[i] = words[i].load(std::memory_order_relaxed);
+        }
+        T value;
+        std::memcpy(&value, buffer, sizeof(T));
+        update(value);
+        sequence.store(current + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        store(value);
+        sequence.store(current + 2, std::memory_order_release);
+    }
+};
+
+/**
+ * Read-copy-update cell with quiescent-state-based reclamation
+ *
+ * The object is reached through an atomic pointer. A reader only loads the pointer and reads the object,
+ * and a writer never modifies an object that has been published: it copies it, changes the copy and swaps
+ * the pointer, so a reader sees either the old or the new object, never a half-written one.
+ *
+ * The old object can only be freed when no reader still holds a pointer to it. Every reader thread registers
+ * a Reader with the cell and calls `quiescent()` from time to time, at a point where it holds no pointer
+ * from the cell, e.g. between two requests. That stores the cell's current epoch in the Reader's own
+ * cache line, never written by any other thread. A writer increments the epoch after each swap and tags
+ * the old object with the new epoch, and frees it once every registered reader has reported that epoch:
+ * each of them has passed a quiescent state after the swap, so none can still hold the old pointer.
+ * The freeing is deferred, never waited for: a writer frees what is free and leaves the rest to the next one.
+ *
+ * A reader that stops calling `quiescent()` keeps the retired objects alive, so a thread that stops
+ * reading for a while destroys its Reader.
+ * @tparam T - The object
+ */
+template<typename T>
+class RcuCell {
+public:
+    /**
+     * The registration of a reader thread, on its own stack
+     */
+    class Reader {
+        RcuCell &cell;
+        alignas(64) std::atomic<std::uint64_t> quiescentEpoch;
+
+        friend class RcuCell;
+
+    public:
+        explicit Reader(RcuCell &cell) : cell(cell) {
+            std::lock_guard<std::mutex> guard(cell.writerMutex);
+            quiescentEpoch.store(cell.epoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            cell.readers.push_back(this);
+        }
+
+        ~Reader() {
+            std::lock_guard<std::mutex> guard(cell.writerMutex);
+            cell.readers.erase(std::find(cell.readers.begin(), cell.readers.end(), this));
+            cell.reclaim();
+        }
+
+        Reader(const Reader &) = delete;
+        Reader &operator=(const Reader &) = delete;
+
+        /**
+         * @return - The current object, valid until the next call of quiescent()
+         */
+        const T *read() const { return cell.current.load(std::memory_order_acquire); }
+
+        /**
+         * Report that this thread holds no pointer from the cell
+         */
+        void quiescent() {
+            // Release: the reads of the objects are done before the store.
+            // Acquire: seeing an epoch means seeing the swap before it in the next read()
+            quiescentEpoch.store(cell.epoch.load(std::memory_order_acquire), std::memory_order_release);
+        }
+    };
+
+private:
+    alignas(64) std::atomic<const T *> current;
+    alignas(64) std::atomic<std::uint64_t> epoch{1};
+    std::mutex writerMutex;
+    std::vector<Reader *> readers;
+    std::vector<std::pair<const T *, std::uint64_t>> retired;   // An old object and the epoch it was retired in
+
+    /**
+     * Free the retired objects no reader can hold any more, the mutex must be held
+     */
+    void reclaim() {
+        std::uint64_t oldest = epoch.load(std::memory_order_relaxed);
+        for (const Reader *reader: readers) {
+            oldest = std::min(oldest, reader->quiescentEpoch.load(std::memory_order_acquire));
+        }
+        std::size_t kept = 0;
+        for (const auto &old: retired) {
+            if (old.second <= oldest) {
+                delete old.first;
+            } else {
+                retired[kept++] = old;
+            }
+        }
+        retired.resize(kept);
+    }
+
+    /**
+     * Swap in a new object and retire the old one, the mutex must be held
+     * @param next - The new object
+     */
+    void swap(const T *next) {
+        const T *old = current.exchange(next, std::memory_order_acq_rel);
+        retired.emplace_back(old, epoch.fetch_add(1, std::memory_order_acq_rel) + 1);
+        reclaim();
+    }
+
+public:
+    explicit RcuCell(std::unique_ptr<T> initial) : current(initial.release()) {}
+
+    /**
+     * All readers must have destroyed their Reader
+     */
+    ~RcuCell() {
+        for (const auto &old: retired) {
+            delete old.first;
+        }
+        delete current.load(std::memory_order_relaxed);
+    }
+
+    RcuCell(const RcuCell &) = delete;
+    RcuCell &operator=(const RcuCell &) = delete;
+
+    /**
+     * Publish a new object and retire the old one
+     * @param next - The new object
+     */
+    void publish(std::unique_ptr<T> next) {
+        std::lock_guard<std::mutex> guard(writerMutex);
+        swap(next.release());
+    }
+
+    /**
+     * Publish a modified copy of the current object
+     * @param update - Called with the copy to modify
+     */
+    template<typename Update>
+    void update(Update update) {
+        std::lock_guard<std::mutex> guard(writerMutex);
+        std::unique_ptr<T> next(new T(*current.load(std::memory_order_relaxed)));
+        update(*next);
+        swap(next.release());
+    }
+
+    /**
+     * @return - The number of retired objects not freed yet
+     */
+    std::size_t pending() {
+        std::lock_guard<std::mutex> guard(writerMutex);
+        return retired.size();
+    }
+};
+
+#endif // SYNCHRONIZATIONREADERWRITERLOCKS_READ_MOSTLY_H
@@ -0,0 +1,263 @@
+#ifndef SYNCHRONIZATIONREADERWRITERLOCKS_RW_LOCKS_H
+#define SYNCHRONIZATIONREADERWRITERLOCKS_RW_LOCKS_H
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+#include "semaphore.h"
+
+/**
+ * Reader-writer locks
+ *
+ * Every lock has the interface of std::shared_mutex: `lock()` / `unlock()` for a writer and
+ * `lock_shared()` / `unlock_shared()` for a reader, so std::unique_lock and std::shared_lock work with them
+ * and the benchmark runs std::shared_mutex itself next to them.
+ */
+
+/**
+ * Tell the processor that the thread is spinning
+ */
+inline void spinPause() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield");
+#endif
+}
+
+/**
+ * Count the spins of a waiter and give up the processor once it has spun for a while
+ * On a single processor the thread it waits for cannot run during the spin, so it yields at once.
+ */
+class SpinWait {
+    int spins = 0;
+
+public:
+    void wait() {
+        // Roughly the cost of a context switch in pauses
+        static const int maxSpins = std::thread::hardware_concurrency() > 1 ? 4096 : 0;
+        if (spins < maxSpins) {
+            spins++;
+            spinPause();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+};
+
+/**
+ * The solution of SynchronizationFirstReaderWriterProblem
+ *
+ * Every reader takes `readerCountMutex` twice, to count itself in and out, and the first reader in
+ * takes the resource for all readers, the last one out gives it back. The demo does this with a std::mutex,
+ * but a std::mutex must be unlocked by the thread that locked it and the last reader is often another thread,
+ * so the resource is the binary semaphore of the textbook solution here (the Semaphore class of
+ * SynchronizationSemaphore). All readers update `readerCount` under the same mutex: its cache line moves
+ * from core to core on every read, and the reads are serialized on it no matter how many cores there are.
+ */
+class FirstReadersWritersLock {
+    std::mutex readerCountMutex;
+    int readerCount = 0;
+    Semaphore resource{1};
+
+public:
+    void lock() { resource.wait(); }
+
+    void unlock() { resource.signal(); }
+
+    void lock_shared() {
+        std::lock_guard<std::mutex> guard(readerCountMutex);
+        if (++readerCount == 1) {
+            resource.wait();
+        }
+    }
+
+    void unlock_shared() {
+        std::lock_guard<std::mutex> guard(readerCountMutex);
+        if (--readerCount == 0) {
+            resource.signal();
+        }
+    }
+};
+
+/**
+ * Reader-writer lock with distributed reader indicators
+ *
+ * Instead of one shared reader count, every thread counts itself in a slot of its own, one cache line per slot,
+ * so readers on different cores never write the same cache line and the read side scales with the cores.
+ * Threads get the slots round-robin at their first read; with more threads than slots some share one,
+ * which is only slower, as a slot is a counter.
+ *
+ * The writer pays instead: it raises the `writer` flag and then waits until every slot has drained to zero.
+ * A reader increments its slot before it checks the flag and the writer raises the flag before it reads the slots,
+ * both sequentially consistent, so at least one of them sees the other: either the reader sees the flag,
+ * leaves its slot again and waits for the writer to finish, or the writer sees the reader and waits for it.
+ * Writers take `writerMutex` first, so there is one at a time.
+ *
+ * Readers back off while a writer is waiting, so a stream of writers can delay the readers.
+ * The lock is meant for data that is read far more often than it is written.
+ */
+class DistributedReaderWriterLock {
+    struct alignas(64) Slot {
+        std::atomic<int> readers{0};
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    unsigned mask;
+    alignas(64) std::atomic<bool> writer{false};
+    std::mutex writerMutex;
+
+    /**
+     * @return - The slot of the calling thread, the same for all locks
+     */
+    static unsigned threadSlot() {
+        static std::atomic<unsigned> nextSlot{0};
+        thread_local unsigned slot = nextSlot.fetch_add(1, std::memory_order_relaxed);
+        return slot;
+    }
+
+    /**
+     * @return - Twice the number of hardware threads rounded up to a power of two
+     */
+    static unsigned defaultSlots() {
+        unsigned wanted = 2 * std::max(1u, std::thread::hardware_concurrency());
+        unsigned count = 1;
+        while (count < wanted) {
+            count *= 2;
+        }
+        return count;
+    }
+
+public:
+    /**
+     * @param slotCount - The number of reader indicators, rounded up to a power of two
+     */
+    explicit DistributedReaderWriterLock(unsigned slotCount = defaultSlots()) {
+        unsigned count = 1;
+        while (count < slotCount) {
+            count *= 2;
+        }
+        slots.reset(new Slot[count]);
+        mask = count - 1;
+    }
+
+    DistributedReaderWriterLock(const DistributedReaderWriterLock &) = delete;
+    DistributedReaderWriterLock &operator=(const DistributedReaderWriterLock &) = delete;
+
+    void lock() {
+        writerMutex.lock();
+        writer.store(true);
+        // Drain the readers, new ones see the flag and stay out
+        for (unsigned i = 0; i <= mask; i++) {
+            SpinWait spin;
+            while (slots[i].readers.load() != 0) {
+                spin.wait();
+            }
+        }
+    }
+
+    void unlock() {
+        writer.store(false, std::memory_order_release);
+        writerMutex.unlock();
+    }
+
+    void lock_shared() {
+        std::atomic<int> &readers = slots[threadSlot() & mask].readers;
+        while (true) {
+            readers.fetch_add(1);
+            if (!writer.load()) {
+                return;
+            }
+            // A writer is in or waiting for the readers to drain, step out of its way
+            readers.fetch_sub(1, std::memory_order_release);
+            SpinWait spin;
+            while (writer.load(std::memory_order_relaxed)) {
+                spin.wait();
+            }
+        }
+    }
+
+    void unlock_shared() {
+        slots[threadSlot() & mask].readers.fetch_sub(1, std::memory_order_release);
+    }
+};
+
+/**
+ * Phase-fair reader-writer lock (the ticket-based PF-T lock of Brandenburg and Anderson)
+ *
+ * In the first readers-writers solution a writer waits until `reader_count` drops to zero, and new readers
+ * keep joining while it is above zero, so under a steady stream of readers a writer may wait forever.
+ * Here reader phases and writer phases alternate:
+ * - a writer waits only for the readers that were in when it arrived, and for the writers before it (FIFO tickets),
+ * - a reader that arrives while a writer is waiting or writing waits for that one writer only,
+ *   and then enters together with all the other readers that arrived meanwhile.
+ * So a writer waits for at most one reader phase per writer ahead of it and a reader for at most one writer phase,
+ * however many readers keep arriving.
+ *
+ * `readerIn` counts the readers that came in, in steps of `readerStep`, and its two low bits tell them whether
+ * a writer is present and which of two alternating writer phases it is. `readerOut` counts the readers that left.
+ * A writer takes a ticket on `writerIn` like a ticket lock, then sets the bits: the value of `readerIn` it replaces
+ * is the number of readers it has to wait for, which it compares with `readerOut`.
+ * A reader that finds the bits set waits until they change, i.e. until that writer has finished.
+ */
+class PhaseFairReaderWriterLock {
+    static const unsigned readerStep = 0x100;     // One reader in readerIn and readerOut
+    static const unsigned writerBits = 0x3;       // The writer bits of readerIn
+    static const unsigned writerPresent = 0x2;
+    static const unsigned writerPhase = 0x1;
+
+    alignas(64) std::atomic<unsigned> readerIn{0};
+    alignas(64) std::atomic<unsigned> readerOut{0};
+    alignas(64) std::atomic<unsigned> writerIn{0};
+    alignas(64) std::atomic<unsigned> writerOut{0};
+
+public:
+    PhaseFairReaderWriterLock() = default;
+    PhaseFairReaderWriterLock(const PhaseFairReaderWriterLock &) = delete;
+    PhaseFairReaderWriterLock &operator=(const PhaseFairReaderWriterLock &) = delete;
+
+    void lock() {
+        // Wait for the writers before this one
+        unsigned ticket = writerIn.fetch_add(1, std::memory_order_relaxed);
+        SpinWait spin;
+        while (writerOut.load(std::memory_order_acquire) != ticket) {
+            spin.wait();
+        }
+        // Block new readers, and wait for the readers already in, the counters wrap around together
+        unsigned readersIn = readerIn.fetch_add(writerPresent | (ticket & writerPhase)) & ~writerBits;
+        SpinWait drain;
+        while (readerOut.load(std::memory_order_acquire) != readersIn) {
+            drain.wait();
+        }
+    }
+
+    void unlock() {
+        // Let the blocked readers in, then the next writer
+        readerIn.fetch_and(~writerBits, std::memory_order_release);
+        writerOut.store(writerOut.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    void lock_shared() {
+        unsigned writer = readerIn.fetch_add(readerStep, std::memory_order_acquire) & writerBits;
+        if (writer != 0) {
+            // Wait for this writer only: a writer after it has the other phase bit
+            SpinWait spin;
+            while ((readerIn.load(std::memory_order_acquire) & writerBits) == writer) {
+                spin.wait();
+            }
+        }
+    }
+
+    void unlock_shared() {
+        readerOut.fetch_add(readerStep, std::memory_order_release);
+    }
+};
+
+#endif // SYNCHRONIZATIONREADERWRITERLOCKS_RW_LOCKS_H
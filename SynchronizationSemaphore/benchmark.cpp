@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <semaphore.h>
+
+#include "futex_semaphore.h"
+#include "semaphore.h"
+
+/**
+ * Semaphore benchmark
+ *
+ * Compares the Semaphore class (mutex and condition variable), the FutexSemaphore and POSIX sem_t:
+ * - uncontended: one thread calls wait and signal in a loop, nanoseconds per pair
+ * - contended: N threads use a semaphore with one slot as a lock, millions of wait/signal pairs per second
+ * - ping-pong: two threads take turns through two semaphores, so every wait blocks,
+ *   microseconds per round trip
+ *
+ * Usage:
+ * ```bash
+ * ./SynchronizationSemaphoreBenchmark [threads] [milliseconds]
+ * ```
+ */
+
+/**
+ * POSIX sem_t behind the wait/signal interface of the other two
+ */
+class PosixSemaphore {
+    sem_t semaphore;
+
+public:
+    explicit PosixSemaphore(int initValue) { sem_init(&semaphore, 0, static_cast<unsigned>(initValue)); }
+
+    ~PosixSemaphore() { sem_destroy(&semaphore); }
+
+    PosixSemaphore(const PosixSemaphore &) = delete;
+    PosixSemaphore &operator=(const PosixSemaphore &) = delete;
+
+    void wait() {
+        while (sem_wait(&semaphore) != 0) {
+            // Interrupted by a signal handler, try again
+        }
+    }
+
+    void signal() { sem_post(&semaphore); }
+};
+
+/**
+ * @return - The nanoseconds of one uncontended wait and signal
+ */
+template<typename S>
+double uncontended() {
+    S semaphore(1);
+    const int iterations = 2000000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        semaphore.wait();
+        semaphore.signal();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+/**
+ * @param threads - The number of threads
+ * @param duration - How long they run
+ * @return - The millions of wait/signal pairs per second, with a one-slot semaphore used as a lock
+ */
+template<typename S>
+double contended(int threads, std::chrono::milliseconds duration) {
+    S semaphore(1);
+    std::atomic<bool> stop(false);
+    std::atomic<long long> total(0);
+    long long counter = 0;
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (int id = 0; id < threads; id++) {
+        workers.emplace_back([&] {
+            long long count = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                semaphore.wait();
+                counter++;
+                semaphore.signal();
+                count++;
+            }
+            total += count;
+        });
+    }
+    std::this_thread::sleep_for(duration);
+    stop.store(true);
+    for (auto &worker: workers) {
+        worker.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    if (counter != total.load()) {
+        std::cout << "Mutual exclusion failed" << std::endl;
+    }
+    return double(total.load()) / std::chrono::duration<double>(end - start).count() / 1e6;
+}
+
+/**
+ * @return - The microseconds of one round trip between two threads, each wait blocking
+ */
+template<typename S>
+double pingPong() {
+    S ping(0);
+    S pong(0);
+    const int rounds = 50000;
+    auto start = std::chrono::steady_clock::now();
+    std::thread partner([&] {
+        for (int i = 0; i < rounds; i++) {
+            ping.wait();
+            pong.signal();
+        }
+    });
+    for (int i = 0; i < rounds; i++) {
+        ping.signal();
+        pong.wait();
+    }
+    partner.join();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / rounds;
+}
+
+/**
+ * Run the three measurements of a semaphore and print them
+ * @param name - The name of the semaphore
+ * @param threads - The number of threads of the contended run
+ * @param duration - The duration of the contended run
+ */
+template<typename S>
+void report(const char *name, int threads, std::chrono::milliseconds duration) {
+    std::cout << std::setw(12) << name << std::fixed << std::setprecision(1) << std::setw(18) << uncontended<S>()
+              << std::setprecision(2) << std::setw(18) << contended<S>(threads, duration) << std::setw(18)
+              << pingPong<S>() << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    int threads = argc > 1 ? std::atoi(argv[1]) : 4;
+    std::chrono::milliseconds duration(argc > 2 ? std::atoi(argv[2]) : 500);
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    std::cout << std::thread::hardware_concurrency() << " hardware thread(s), " << threads
+              << " contending thread(s)" << std::endl;
+    std::cout << std::setw(12) << "semaphore" << std::setw(18) << "uncontended ns" << std::setw(18)
+              << "contended Mops/s" << std::setw(18) << "ping-pong us" << std::endl;
+    report<Semaphore>("Semaphore", threads, duration);
+    report<FutexSemaphore>("futex", threads, duration);
+    report<PosixSemaphore>("sem_t", threads, duration);
+    return 0;
+}
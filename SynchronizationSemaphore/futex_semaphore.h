@@ -0,0 +1,99 @@
+#ifndef SYNCHRONIZATIONSEMAPHORE_FUTEX_SEMAPHORE_H
+#define SYNCHRONIZATIONSEMAPHORE_FUTEX_SEMAPHORE_H
+
+#include <atomic>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * Lightweight semaphore on a Linux futex
+ *
+ * The Semaphore class (semaphore.h) takes its mutex on every wait and signal, so the threads contend for the mutex
+ * even when there are slots left. Here the count is an atomic integer,
+ * and the kernel is only entered when a thread really has to sleep:
+ *
+ * - `count` is the number of free slots, or minus the number of threads that are sleeping or about to.
+ *   wait is a fetch_sub: a result above 0 means a slot was free and the thread goes on.
+ *   signal is a fetch_add: a result below 0 means a thread is waiting for the slot and has to be woken.
+ *   Uncontended, each is a single atomic instruction and no system call.
+ * - A thread that has to wait sleeps on `wakeups`, a second futex word counting the wake-ups
+ *   handed out by signal and not yet taken. A wake-up posted before the waiter goes to sleep is not lost:
+ *   FUTEX_WAIT only sleeps while the word still holds the value the waiter saw.
+ *
+ * Before giving up its slot in the queue, a waiter spins for a short while trying to take a slot
+ * that is freed in the meantime, which saves the sleep and the wake-up for short critical sections.
+ * On a single processor the thread holding the slot cannot run during the spin, so there is only the first try.
+ */
+class FutexSemaphore {
+    std::atomic<int> count;
+    std::atomic<int> wakeups{0};
+
+    static_assert(sizeof(std::atomic<int>) == sizeof(int), "The futex word is the atomic int itself");
+
+    static long futex(std::atomic<int> &word, int operation, int value) {
+        return syscall(SYS_futex, reinterpret_cast<int *>(&word), operation, value, nullptr, nullptr, 0);
+    }
+
+    /**
+     * Sleep until signal hands out a wake-up, and take it
+     */
+    void sleep() {
+        while (true) {
+            int available = wakeups.load(std::memory_order_relaxed);
+            while (available > 0) {
+                if (wakeups.compare_exchange_weak(available, available - 1, std::memory_order_acquire,
+                                                  std::memory_order_relaxed)) {
+                    return;
+                }
+            }
+            // Returns at once if a wake-up was posted since the load
+            futex(wakeups, FUTEX_WAIT_PRIVATE, 0);
+        }
+    }
+
+public:
+    explicit FutexSemaphore(int initValue) : count(initValue) {}
+
+    FutexSemaphore(const FutexSemaphore &) = delete;
+    FutexSemaphore &operator=(const FutexSemaphore &) = delete;
+
+    /**
+     * Wait operation
+     */
+    void wait() {
+        // Spin a little on a free slot before queueing, unless no other thread can run to free it meanwhile
+        static const int maxSpins = std::thread::hardware_concurrency() > 1 ? 40 : 1;
+        for (int spins = 0; spins < maxSpins; spins++) {
+            int available = count.load(std::memory_order_relaxed);
+            if (available > 0 && count.compare_exchange_weak(available, available - 1, std::memory_order_acquire,
+                                                             std::memory_order_relaxed)) {
+                return;
+            }
+#if defined(__x86_64__) || defined(__i386__)
+            _mm_pause();
+#endif
+        }
+        if (count.fetch_sub(1, std::memory_order_acquire) <= 0) {
+            sleep();
+        }
+    }
+
+    /**
+     * Signal operation
+     */
+    void signal() {
+        if (count.fetch_add(1, std::memory_order_release) < 0) {
+            // A thread is waiting (or about to), give it a wake-up
+            wakeups.fetch_add(1, std::memory_order_release);
+            futex(wakeups, FUTEX_WAKE_PRIVATE, 1);
+        }
+    }
+};
+
+#endif // SYNCHRONIZATIONSEMAPHORE_FUTEX_SEMAPHORE_H
@@ -34,39 +34,11 @@
 #include <iostream>
 #include <thread>
 #include <mutex>
-#include <condition_variable>
 #include <vector>
 #include <sstream>
+#include <string>
 
-class Semaphore {
-    int value;            // Tracks the number of available slots
-    std::mutex mtx;       // Mutex to protect value and condition variable
-    std::condition_variable cv;
-
-public:
-    explicit Semaphore(int initValue) : value(initValue) {}
-
-    /**
-     * Wait operation
-     */
-    void wait() {
-        std::unique_lock<std::mutex> lock(mtx);
-        // Use a loop to handle spurious wake-ups
-        while (value <= 0) {
-            cv.wait(lock);
-        }
-        value--;          // Decrement the number of available slots only if not waiting
-    }
-
-    /**
-     * Signal operation
-     */
-    void signal() {
-        std::unique_lock<std::mutex> lock(mtx);
-        value++;          // Increment the number of available slots
-        cv.notify_one();  // Notify one waiting thread
-    }
-};
+#include "semaphore.h"
 
 std::vector<std::string> logs;
 std::mutex log_mutex;     // Protect access to logs
@@ -103,15 +75,50 @@ void task(int id, Semaphore& sem) {
     sem.signal();
 }
 
+/**
+ * Task that takes both slots at once, e.g. a job that needs two resources
+ *
+ * @param id - The id of the thread
+ * @param sem - The semaphore to use
+ */
+void batch_task(int id, Semaphore& sem) {
+    sem.wait(2);
+    critical_section(id);
+    sem.signal(2);
+}
+
+/**
+ * Task that gives up if it cannot enter within a deadline
+ *
+ * @param id - The id of the thread
+ * @param sem - The semaphore to use
+ */
+void timed_task(int id, Semaphore& sem) {
+    if (!sem.wait_for(std::chrono::milliseconds(500))) {
+        std::lock_guard<std::mutex> guard(log_mutex);
+        logs.push_back("Thread " + std::to_string(id) + " timed out after 500ms.\n");
+        return;
+    }
+    critical_section(id);
+    sem.signal();
+}
+
 int main() {
     const int num_threads = 6;
     Semaphore sem(2);  // Initialize semaphore with 2 available slots
     std::vector<std::thread> threads;
 
-    threads.reserve(num_threads);
+    threads.reserve(num_threads + 1);
     for (int i = 0; i < num_threads; i++) {
-        threads.emplace_back(task, i + 1, std::ref(sem));
+        // Thread 3 needs both slots, it enters after threads 1 and 2 even though 4, 5 and 6 each need only one
+        if (i + 1 == 3) {
+            threads.emplace_back(batch_task, i + 1, std::ref(sem));
+        } else {
+            threads.emplace_back(task, i + 1, std::ref(sem));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));  // Arrive in order
     }
+    threads.emplace_back(timed_task, num_threads + 1, std::ref(sem));
 
     std::cout << "Main thread is waiting for all threads to finish...\n";
 
@@ -123,6 +130,11 @@ int main() {
         std::cout << log;
     }
 
+    if (sem.try_wait(2)) {
+        std::cout << "All slots are free again.\n";
+        sem.signal(2);
+    }
+
     return 0;
 }
 
@@ -138,6 +150,10 @@ int main() {
  * 有界等待:
  * - 通過使用條件變量和合適的喚醒策略（notify_one），信號量實現確保了等待的執行緒不會無限期地等待。
  * - 每當信號操作發生，都會有一個等待的執行緒被喚醒，這有助於保證等待的有界性。
+ * - 等待的執行緒依照到達順序排在佇列中（FIFO），新的請求在佇列不為空時也要排隊，
+ *   所以一次要兩個槽位的執行緒 3 不會被之後只要一個槽位的執行緒一直插隊而餓死。
+ * - signal(n) 只喚醒拿得到槽位的執行緒，而不是呼叫 n 次 notify_one。
+ * - wait_for 可以設定等待的期限，逾時的執行緒離開佇列，不會無限期地等待。
  *
  * 補充:
  * - 可以使用 sleep 與 wakeup 來實現信號量的 wait 與 signal 操作，避免 while 循環中的繁忙等待。
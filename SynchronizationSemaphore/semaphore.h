@@ -0,0 +1,148 @@
+#ifndef SYNCHRONIZATIONSEMAPHORE_SEMAPHORE_H
+#define SYNCHRONIZATIONSEMAPHORE_SEMAPHORE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+
+/**
+ * Counting semaphore built on a mutex and a condition variable
+ * A waiting thread sleeps on a condition variable instead of busy waiting (see main.cpp).
+ *
+ * A thread can reserve several units at once with wait(n), atomically: either it gets all n or it waits,
+ * so two threads each holding part of what the other needs cannot deadlock the way n calls of wait() could.
+ *
+ * The waiters are served in arrival order. Every waiter sleeps on its own condition variable in a FIFO queue,
+ * and a new request only takes units directly when nobody is queued. Otherwise a request for many units
+ * could wait forever while a stream of small requests keeps taking the units as they come back.
+ * signal(n) hands the units to the front of the queue for as long as they suffice
+ * and wakes exactly the waiters it served, no more.
+ */
+class Semaphore {
+    /**
+     * A thread waiting for units, on its own stack
+     */
+    struct Waiter {
+        int units;
+        bool granted = false;
+        std::condition_variable cv;
+
+        explicit Waiter(int units) : units(units) {}
+    };
+
+    int value;            // Tracks the number of available slots
+    std::mutex mtx;       // Mutex to protect value and the queue
+    std::list<Waiter *> queue;
+
+    static void checkUnits(int n) {
+        if (n <= 0) {
+            throw std::invalid_argument("A semaphore operation needs a positive number of units.");
+        }
+    }
+
+    /**
+     * Hand the available units to the waiters at the front of the queue, the mutex must be held
+     */
+    void grant() {
+        while (!queue.empty() && queue.front()->units <= value) {
+            Waiter *waiter = queue.front();
+            queue.pop_front();
+            value -= waiter->units;
+            waiter->granted = true;
+            waiter->cv.notify_one();
+        }
+    }
+
+    /**
+     * Queue the calling thread and sleep until it is granted its units or the deadline passes
+     * @param lock - The held mutex
+     * @param n - The number of units
+     * @param deadline - The deadline, or nullptr to wait forever
+     * @return - True if the units were granted
+     */
+    bool enqueue(std::unique_lock<std::mutex> &lock, int n, const std::chrono::steady_clock::time_point *deadline) {
+        Waiter waiter(n);
+        auto position = queue.insert(queue.end(), &waiter);
+        // Use a loop to handle spurious wake-ups
+        while (!waiter.granted) {
+            if (deadline == nullptr) {
+                waiter.cv.wait(lock);
+            } else if (waiter.cv.wait_until(lock, *deadline) == std::cv_status::timeout && !waiter.granted) {
+                queue.erase(position);
+                // The waiters behind it may be satisfied now
+                grant();
+                return false;
+            }
+        }
+        return true;
+    }
+
+public:
+    explicit Semaphore(int initValue) : value(initValue) {}
+
+    Semaphore(const Semaphore &) = delete;
+    Semaphore &operator=(const Semaphore &) = delete;
+
+    /**
+     * Wait operation
+     * @param n - The number of units to take, all at once
+     */
+    void wait(int n = 1) {
+        checkUnits(n);
+        std::unique_lock<std::mutex> lock(mtx);
+        if (queue.empty() && value >= n) {
+            value -= n;   // Decrement the number of available slots only if not waiting
+            return;
+        }
+        enqueue(lock, n, nullptr);
+    }
+
+    /**
+     * Take units only if they are available now
+     * @param n - The number of units
+     * @return - True if the units were taken
+     */
+    bool try_wait(int n = 1) {
+        checkUnits(n);
+        std::lock_guard<std::mutex> lock(mtx);
+        if (queue.empty() && value >= n) {
+            value -= n;
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * Wait for units for at most a given time
+     * @param timeout - The longest time to wait
+     * @param n - The number of units
+     * @return - True if the units were taken, false if the time ran out
+     */
+    template<typename Rep, typename Period>
+    bool wait_for(const std::chrono::duration<Rep, Period> &timeout, int n = 1) {
+        checkUnits(n);
+        auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout);
+        std::unique_lock<std::mutex> lock(mtx);
+        if (queue.empty() && value >= n) {
+            value -= n;
+            return true;
+        }
+        return enqueue(lock, n, &deadline);
+    }
+
+    /**
+     * Signal operation
+     * @param n - The number of units to give back
+     */
+    void signal(int n = 1) {
+        checkUnits(n);
+        std::lock_guard<std::mutex> lock(mtx);
+        value += n;       // Increment the number of available slots
+        grant();          // Wake the waiters that can proceed now
+    }
+};
+
+#endif // SYNCHRONIZATIONSEMAPHORE_SEMAPHORE_H
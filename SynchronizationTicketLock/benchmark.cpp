@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "ticket_lock.h"
+
+/**
+ * Fair lock benchmark
+ *
+ * n threads repeatedly take the lock, update a shared counter and release it, for a fixed time,
+ * with n = 2, 4, 8, ... For each lock it reports:
+ * - the acquisitions per second of all threads together, in millions
+ * - the fairness: the fewest acquisitions of a thread divided by the most
+ * - the average release time in nanoseconds, which is O(n) for the bounded-waiting scan and O(1) for the ticket locks
+ *
+ * bounded waiting is the lock of SynchronizationBoundedWaitingMutualExclusionTestAndSet with its packed
+ * `std::atomic<bool>` flags, bounded waiting padded is the same lock with one cache line per flag.
+ *
+ * Usage:
+ * ```bash
+ * ./SynchronizationTicketLockBenchmark [milliseconds] [max threads]
+ * ```
+ */
+
+/**
+ * The result of one run
+ */
+struct Result {
+    double acquisitionsPerSecond;
+    double fairness;
+    double releaseNanoseconds;
+    bool correct;
+};
+
+/**
+ * Let the threads hammer a lock for a while
+ * @param threads - The number of threads
+ * @param duration - How long they run
+ * @return - The throughput, fairness and release time
+ */
+template<typename Lock>
+Result run(int threads, std::chrono::milliseconds duration) {
+    Lock lock(threads);
+    alignas(64) long long counter = 0;
+    std::atomic<int> ready(0);
+    std::atomic<bool> start(false);
+    std::atomic<bool> stop(false);
+    std::vector<long long> counts(threads, 0);
+    std::vector<double> releaseSeconds(threads, 0);
+
+    std::vector<std::thread> workers;
+    for (int id = 0; id < threads; id++) {
+        workers.emplace_back([&, id] {
+            long long count = 0;
+            std::chrono::steady_clock::duration releasing{0};
+            ready++;
+            while (!start.load()) {
+                std::this_thread::yield();
+            }
+            while (!stop.load(std::memory_order_relaxed)) {
+                lock.lock(id);
+                counter++;
+                auto releaseStart = std::chrono::steady_clock::now();
+                lock.unlock(id);
+                releasing += std::chrono::steady_clock::now() - releaseStart;
+                count++;
+                // A little work outside of the lock
+                for (int i = 0; i < 16; i++) {
+                    spinPause();
+                }
+            }
+            counts[id] = count;
+            releaseSeconds[id] = std::chrono::duration<double>(releasing).count();
+        });
+    }
+    while (ready.load() < threads) {
+        std::this_thread::yield();
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true);
+    std::this_thread::sleep_for(duration);
+    stop.store(true);
+    for (auto &worker: workers) {
+        worker.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    long long total = 0;
+    double released = 0;
+    for (int id = 0; id < threads; id++) {
+        total += counts[id];
+        released += releaseSeconds[id];
+    }
+    auto extremes = std::minmax_element(counts.begin(), counts.end());
+    Result result;
+    result.acquisitionsPerSecond = double(total) / std::chrono::duration<double>(end - begin).count();
+    result.fairness = *extremes.second > 0 ? double(*extremes.first) / double(*extremes.second) : 0;
+    result.releaseNanoseconds = total > 0 ? released / double(total) * 1e9 : 0;
+    result.correct = counter == total;
+    return result;
+}
+
+/**
+ * Print the result of a lock
+ * @param name - The name of the lock
+ * @param result - The result
+ */
+void report(const char *name, const Result &result) {
+    std::cout << std::setw(26) << name << std::fixed << std::setprecision(2) << std::setw(12)
+              << result.acquisitionsPerSecond / 1e6 << std::setw(12) << result.fairness << std::setprecision(1)
+              << std::setw(14) << result.releaseNanoseconds << (result.correct ? "" : "  lost updates") << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    std::chrono::milliseconds duration(argc > 1 ? std::atoi(argv[1]) : 500);
+    int maxThreads = argc > 2 ? std::atoi(argv[2]) : 256;
+
+    std::cout << std::thread::hardware_concurrency() << " hardware thread(s), " << duration.count()
+              << " ms per run" << std::endl;
+    for (int threads = 2; threads <= maxThreads; threads *= 2) {
+        std::cout << "n = " << threads << std::endl;
+        std::cout << std::setw(26) << "lock" << std::setw(12) << "Macq/s" << std::setw(12) << "fairness"
+                  << std::setw(14) << "release ns" << std::endl;
+        report("bounded waiting", run<BoundedWaitingLock<PackedFlag>>(threads, duration));
+        report("bounded waiting padded", run<BoundedWaitingLock<PaddedFlag>>(threads, duration));
+        report("ticket", run<TicketLock>(threads, duration));
+        report("ticket backoff", run<ProportionalBackoffTicketLock>(threads, duration));
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <chrono>
+
+#include "ticket_lock.h"
+
+const int n = 3; // Number of threads
+TicketLock ticket_lock;
+ProportionalBackoffTicketLock backoff_lock;
+
+/**
+ * The function is used to acquire the ticket lock.
+ *
+ * @param id - The id of the thread.
+ * @param critical_section - The function pointer to the critical section.
+ */
+void acquire_ticket(int id, void (*critical_section)(int)) {
+    acquire(ticket_lock, id, critical_section);
+}
+
+/**
+ * The function is used to acquire the ticket lock with proportional backoff.
+ *
+ * @param id - The id of the thread.
+ * @param critical_section - The function pointer to the critical section.
+ */
+void acquire_backoff(int id, void (*critical_section)(int)) {
+    acquire(backoff_lock, id, critical_section);
+}
+
+/**
+ * The function is used to execute the critical section.
+ *
+ * @param id - The id of the thread.
+ */
+void critical_section(int id) {
+    for (int i = 0; i < 3; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        std::cout << "Delay " << (i + 1) * 200 << " millisecond(s)." << " Thread id: " << id << std::endl;
+    }
+
+    std::cout << "Critical section is executed." << " Thread id: " << id << std::endl;
+}
+
+/**
+ * Start n threads on an acquire function and join them
+ *
+ * @param acquire_function - The acquire function.
+ */
+void run(void (*acquire_function)(int, void (*)(int))) {
+    std::vector<std::thread> threads;
+    threads.reserve(n);
+    for (int i = 0; i < n; i++) {
+        threads.emplace_back(acquire_function, i, critical_section);
+    }
+
+    // Join all threads to the main thread
+    for (auto &t: threads) {
+        t.join();
+    }
+}
+
+int main() {
+    std::cout << "Ticket lock:" << std::endl;
+    run(acquire_ticket);
+
+    std::cout << "Ticket lock with proportional backoff:" << std::endl;
+    run(acquire_backoff);
+
+    return 0;
+}
+
+/**
+ * 互斥執行:
+ * - fetch_add 保證每個執行緒拿到不同的號碼牌，同一時間只有號碼等於 nowServing 的執行緒可以進入關鍵區段。
+ *
+ * 進展:
+ * - 沒有人等待時，拿到的號碼牌就是 nowServing，立即進入。
+ *
+ * 有界等待:
+ * - 執行緒依照號碼牌的順序 (FIFO) 進入，前面最多只有 n - 1 個執行緒，因此等待是有界的。
+ * - 與 bounded waiting test-and-set 相比，釋放鎖只需要把 nowServing 加一，是 O(1)，
+ *   不需要用 (j + 1) % n 掃描整個 waiting 陣列。
+ *
+ * Proportional backoff:
+ * - 前面有 k 個執行緒時，至少還要等 k 個關鍵區段，因此每次讀取 nowServing 之間暫停與 k 成正比的時間，
+ *   減少所有等待者同時讀取 nowServing 造成的快取行搬移。
+ */
@@ -0,0 +1,195 @@
+#ifndef SYNCHRONIZATIONTICKETLOCK_TICKET_LOCK_H
+#define SYNCHRONIZATIONTICKETLOCK_TICKET_LOCK_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+/**
+ * Fair locks with bounded waiting
+ *
+ * The bounded-waiting lock of SynchronizationBoundedWaitingMutualExclusionTestAndSet keeps a `waiting` flag
+ * per thread. The releasing thread scans the flags from its own id onwards and hands the lock to the first waiter,
+ * so every thread enters after at most n - 1 others. But the release costs O(n) even when nobody waits,
+ * all the waiters spin with test-and-set on the same `lock`, and the flags of neighbouring threads share
+ * a cache line (false sharing), so writing one flag invalidates the line all the others are reading.
+ *
+ * A ticket lock gives the same guarantee with O(1) hand-over, like a numbered ticket at a counter:
+ * - acquire takes the next ticket with one fetch-and-add and waits until `nowServing` shows it,
+ * - release increments `nowServing`, a plain store since only the holder writes it.
+ * The threads enter in the order of their tickets (FIFO), so each one waits for at most n - 1 others.
+ *
+ * All the waiters still read `nowServing`, so every release invalidates it in every waiter's cache.
+ * The proportional-backoff ticket lock uses the distance to the front of the queue:
+ * a thread with k threads ahead of it will not be served for about k critical sections,
+ * so it pauses for a time proportional to k between two reads instead of reading continuously.
+ */
+
+/**
+ * Tell the processor that the thread is spinning
+ */
+inline void spinPause() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield");
+#endif
+}
+
+/**
+ * Count the spins of a waiter and give up the processor once it has spun for a while
+ * A fair lock hands over to one particular thread. When there are more threads than cores and that thread
+ * is not running, the others would spin for their whole time slice, so they yield instead.
+ */
+class SpinWait {
+    int spins = 0;
+
+public:
+    void wait(int pauses = 1) {
+        // Roughly the cost of a context switch in pauses
+        if (spins < 4096) {
+            spins += pauses;
+            for (int i = 0; i < pauses; i++) {
+                spinPause();
+            }
+        } else {
+            std::this_thread::yield();
+        }
+    }
+};
+
+/**
+ * A waiting flag alone in its cache line
+ */
+struct alignas(64) PaddedFlag {
+    std::atomic<bool> value{false};
+};
+
+/**
+ * A waiting flag packed next to the others, as in the original std::vector<std::atomic<bool>>
+ */
+struct PackedFlag {
+    std::atomic<bool> value{false};
+};
+
+/**
+ * The bounded-waiting test-and-set lock of SynchronizationBoundedWaitingMutualExclusionTestAndSet
+ * @tparam Flag - PackedFlag for the original layout, PaddedFlag for one cache line per flag
+ */
+template<typename Flag>
+class BoundedWaitingLock {
+    alignas(64) std::atomic<bool> lockFlag{false};
+    std::vector<Flag> waiting;
+    int n;
+
+public:
+    /**
+     * @param threads - The number of threads, the ids are 0 to threads - 1
+     */
+    explicit BoundedWaitingLock(int threads) : waiting(threads), n(threads) {}
+
+    void lock(int id) {
+        waiting[id].value.store(true);
+        bool key = true;
+        while (waiting[id].value.load() && key) {
+            key = lockFlag.exchange(true);
+            if (key) {
+                // Yield like the waiters of the other locks here, so the benchmark compares the locks and not the waiting
+                std::this_thread::yield();
+            }
+        }
+        waiting[id].value.store(false);
+    }
+
+    void unlock(int id) {
+        // O(n): look for the next waiter after id
+        int j = (id + 1) % n;
+        while ((j != id) && !waiting[j].value.load()) {
+            j = (j + 1) % n;
+        }
+
+        if (j == id) {
+            lockFlag.store(false);
+        } else {
+            waiting[j].value.store(false);
+        }
+    }
+};
+
+/**
+ * Ticket lock
+ * The two counters are in separate cache lines: taking a ticket does not disturb the waiters reading `nowServing`.
+ */
+class TicketLock {
+    alignas(64) std::atomic<unsigned> nextTicket{0};
+    alignas(64) std::atomic<unsigned> nowServing{0};
+
+public:
+    explicit TicketLock(int = 0) {}
+
+    void lock(int) {
+        unsigned ticket = nextTicket.fetch_add(1, std::memory_order_relaxed);
+        SpinWait spin;
+        while (nowServing.load(std::memory_order_acquire) != ticket) {
+            spin.wait();
+        }
+    }
+
+    void unlock(int) {
+        // Only the holder writes nowServing, no read-modify-write is needed
+        nowServing.store(nowServing.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+};
+
+/**
+ * Ticket lock with proportional backoff
+ */
+class ProportionalBackoffTicketLock {
+    alignas(64) std::atomic<unsigned> nextTicket{0};
+    alignas(64) std::atomic<unsigned> nowServing{0};
+
+    // Pauses per thread ahead, a guess of the length of a critical section plus its hand-over
+    static const unsigned backoffPerWaiter = 32;
+
+public:
+    explicit ProportionalBackoffTicketLock(int = 0) {}
+
+    void lock(int) {
+        unsigned ticket = nextTicket.fetch_add(1, std::memory_order_relaxed);
+        SpinWait spin;
+        while (true) {
+            unsigned serving = nowServing.load(std::memory_order_acquire);
+            if (serving == ticket) {
+                return;
+            }
+            // The counters wrap around together, the difference is the number of threads ahead
+            spin.wait(static_cast<int>((ticket - serving) * backoffPerWaiter));
+        }
+    }
+
+    void unlock(int) {
+        nowServing.store(nowServing.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+};
+
+/**
+ * Run a critical section under a lock, in the shape of the acquire function of the bounded-waiting example
+ * @param lock - The lock
+ * @param id - The id of the thread
+ * @param critical_section - The critical section to be executed
+ */
+template<typename Lock>
+void acquire(Lock &lock, int id, void (*critical_section)(int)) {
+    lock.lock(id);
+
+    // Execute critical section
+    critical_section(id);
+
+    lock.unlock(id);
+}
+
+#endif // SYNCHRONIZATIONTICKETLOCK_TICKET_LOCK_H